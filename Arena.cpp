@@ -0,0 +1,179 @@
+#include <sys/mman.h>
+#include "Arena.h"
+
+Arena::Arena()
+{
+    _chunks = nullptr;
+    _bump = nullptr;
+    _bumpEnd = nullptr;
+    for (int sizeClass = 0; sizeClass < ARENA_SIZE_CLASSES; ++sizeClass)
+    {
+        _freeLists[sizeClass] = nullptr;
+    }
+    _largeBlocks = nullptr;
+    _remoteFree = nullptr;
+}
+
+Arena::~Arena()
+{
+    while (_chunks != nullptr)
+    {
+        Chunk* next = _chunks->next;
+        munmap(_chunks, ARENA_CHUNK_SIZE);
+        _chunks = next;
+    }
+    while (_largeBlocks != nullptr)
+    {
+        LargeBlock* next = _largeBlocks->next;
+        munmap(_largeBlocks, _largeBlocks->mappedSize);
+        _largeBlocks = next;
+    }
+}
+
+int Arena::size_class_of(size_t size)
+{
+    int sizeClass = 0;
+    size_t blockSize = ARENA_MIN_BLOCK;
+    while (blockSize < size && sizeClass < ARENA_SIZE_CLASSES)
+    {
+        blockSize <<= 1;
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+Arena::BlockHeader* Arena::header_of(void* ptr)
+{
+    return (BlockHeader*) ptr - 1;
+}
+
+Arena* Arena::ownerOf(void* ptr)
+{
+    return header_of(ptr)->owner;
+}
+
+void* Arena::allocate(size_t size)
+{
+    if (_remoteFree != nullptr)
+    {
+        drainRemote();
+    }
+    int sizeClass = size_class_of(size);
+    if (sizeClass == ARENA_LARGE_CLASS)
+    {
+        return allocate_large(size);
+    }
+    return allocate_small(sizeClass);
+}
+
+void* Arena::allocate_small(int sizeClass)
+{
+    BlockHeader* header;
+    if (_freeLists[sizeClass] != nullptr)
+    {
+        header = (BlockHeader*) _freeLists[sizeClass];
+        _freeLists[sizeClass] = _freeLists[sizeClass]->next;
+    }
+    else
+    {
+        size_t blockSize = sizeof(BlockHeader) + ((size_t) ARENA_MIN_BLOCK << sizeClass);
+        if (_bump == nullptr || _bump + blockSize > _bumpEnd)
+        {
+            void* memory = mmap(nullptr, ARENA_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED)
+            {
+                return nullptr;
+            }
+            Chunk* chunk = (Chunk*) memory;
+            chunk->next = _chunks;
+            _chunks = chunk;
+            _bump = (char*) (chunk + 1);
+            _bumpEnd = (char*) memory + ARENA_CHUNK_SIZE;
+        }
+        header = (BlockHeader*) _bump;
+        _bump += blockSize;
+    }
+    header->owner = this;
+    header->sizeClass = sizeClass;
+    return header + 1;
+}
+
+void* Arena::allocate_large(size_t size)
+{
+    size_t mappedSize = sizeof(LargeBlock) + sizeof(BlockHeader) + size;
+    void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    LargeBlock* block = (LargeBlock*) memory;
+    block->mappedSize = mappedSize;
+    block->prev = nullptr;
+    block->next = _largeBlocks;
+    if (_largeBlocks != nullptr)
+    {
+        _largeBlocks->prev = block;
+    }
+    _largeBlocks = block;
+
+    BlockHeader* header = (BlockHeader*) (block + 1);
+    header->owner = this;
+    header->sizeClass = ARENA_LARGE_CLASS;
+    return header + 1;
+}
+
+void Arena::release(void* ptr)
+{
+    BlockHeader* header = header_of(ptr);
+    if (header->sizeClass == ARENA_LARGE_CLASS)
+    {
+        LargeBlock* block = (LargeBlock*) header - 1;
+        if (block->prev != nullptr)
+        {
+            block->prev->next = block->next;
+        }
+        else
+        {
+            _largeBlocks = block->next;
+        }
+        if (block->next != nullptr)
+        {
+            block->next->prev = block->prev;
+        }
+        munmap(block, block->mappedSize);
+        return;
+    }
+
+    FreeBlock* freed = (FreeBlock*) header;
+    freed->next = _freeLists[header->sizeClass];
+    _freeLists[header->sizeClass] = freed;
+}
+
+/**
+ * Pushes with compare-and-swap, so a preempted pusher never leaves the list half-linked.
+ */
+void Arena::releaseRemote(void* ptr)
+{
+    FreeBlock* freed = (FreeBlock*) ptr;
+    freed->next = __atomic_load_n(&_remoteFree, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&_remoteFree, &freed->next, freed, true, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+ * Takes the remote list with one store, so a remote free landing meanwhile starts a new list.
+ */
+void Arena::drainRemote()
+{
+    FreeBlock* remote = __atomic_exchange_n(&_remoteFree, (FreeBlock*) nullptr, __ATOMIC_ACQ_REL);
+    while (remote != nullptr)
+    {
+        FreeBlock* next = remote->next;
+        release(remote);
+        remote = next;
+    }
+}
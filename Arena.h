@@ -0,0 +1,90 @@
+#include <stddef.h>
+
+#ifndef EX2_OS_ARENA_H
+#define EX2_OS_ARENA_H
+
+#define ARENA_CHUNK_SIZE 65536 /* bytes mapped at a time for small blocks */
+#define ARENA_MIN_BLOCK 16 /* payload of the smallest size class */
+#define ARENA_SIZE_CLASSES 8 /* 16, 32, ..., 2048 bytes */
+#define ARENA_LARGE_CLASS ARENA_SIZE_CLASSES /* blocks mapped on their own */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * A per-thread allocator. Small blocks are carved from mmap-ed chunks by a bump pointer and
+ * recycled through per-size-class free lists; larger ones are mapped individually. Only the owning
+ * thread touches the bump pointer and the free lists, so allocation needs neither locks nor
+ * signal masking; blocks freed by another thread go through a remote list the owner drains.
+ * Everything is unmapped at once when the arena is destroyed.
+ */
+class Arena
+{
+private:
+    struct BlockHeader
+    {
+        Arena* owner;
+        int sizeClass;
+    } __attribute__((aligned(ARENA_ALIGNMENT)));
+
+    struct LargeBlock
+    {
+        LargeBlock* prev;
+        LargeBlock* next;
+        size_t mappedSize;
+    } __attribute__((aligned(ARENA_ALIGNMENT)));
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct Chunk
+    {
+        Chunk* next;
+    } __attribute__((aligned(ARENA_ALIGNMENT)));
+
+    Chunk* _chunks;
+    char* _bump;
+    char* _bumpEnd;
+    FreeBlock* _freeLists[ARENA_SIZE_CLASSES];
+    LargeBlock* _largeBlocks;
+    FreeBlock* _remoteFree;
+
+    static int size_class_of(size_t size);
+
+    static BlockHeader* header_of(void* ptr);
+
+    void* allocate_small(int sizeClass);
+
+    void* allocate_large(size_t size);
+
+public:
+    Arena();
+
+    ~Arena();
+
+    /**
+     * @return a block of at least size bytes aligned to ARENA_ALIGNMENT, or nullptr if the
+     * memory could not be mapped. Must be called by the owning thread.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Frees a block of this arena. Must be called by the owning thread.
+     */
+    void release(void* ptr);
+
+    /**
+     * Hands a block of this arena back from another thread. Lock-free, safe under preemption.
+     */
+    void releaseRemote(void* ptr);
+
+    /**
+     * Frees the blocks other threads handed back.
+     */
+    void drainRemote();
+
+    static Arena* ownerOf(void* ptr);
+};
+
+
+#endif //EX2_OS_ARENA_H
@@ -0,0 +1,288 @@
+#include <limits.h>
+#include <time.h>
+#include "CoroutineScheduler.h"
+
+#define FAIL -1
+#define MICRO_SECONDS 1000000
+#define NANO_SECONDS_IN_MICRO 1000
+#define INITIAL_SLEEPING_CAPACITY 64
+
+std::atomic<int> CoroutineScheduler::_hostId(FAIL);
+std::atomic<bool> CoroutineScheduler::_hostStarting(false);
+std::atomic<CoroutineNode*> CoroutineScheduler::_incoming(nullptr);
+CoroutineNode* CoroutineScheduler::_readyHead = nullptr;
+CoroutineNode* CoroutineScheduler::_readyTail = nullptr;
+CoroutineNode** CoroutineScheduler::_sleeping = nullptr;
+size_t CoroutineScheduler::_sleepingCount = 0;
+size_t CoroutineScheduler::_sleepingCapacity = 0;
+bool CoroutineScheduler::_mutexHeld = false;
+CoroutineNode* CoroutineScheduler::_mutexWaitersHead = nullptr;
+CoroutineNode* CoroutineScheduler::_mutexWaitersTail = nullptr;
+
+static long long now_usecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * (long long) MICRO_SECONDS + now.tv_nsec / NANO_SECONDS_IN_MICRO;
+}
+
+void CoroutineScheduler::host_main()
+{
+    _hostId = uthread_get_tid();
+    for (;;)
+    {
+        drain_incoming();
+        if (_sleepingCount > 0)
+        {
+            release_sleepers();
+        }
+
+        CoroutineNode* node = pop_ready();
+        if (node != nullptr)
+        {
+            node->handle.resume();
+            continue;
+        }
+
+        if (_sleepingCount == 0)
+        {
+            uthread_park();
+            continue;
+        }
+        long long wait = _sleeping[0]->wakeUsecs - now_usecs();
+        if (wait > 0)
+        {
+            uthread_park_timeout((wait < INT_MAX) ? (int) wait : INT_MAX);
+        }
+    }
+}
+
+/**
+ * Spawns the host thread unless another thread is already doing so. A coroutine pushed before
+ * the host sets its ID is picked up by the host's first drain, so the losers need not wait.
+ */
+bool CoroutineScheduler::start_host()
+{
+    bool expected = false;
+    if (!_hostStarting.compare_exchange_strong(expected, true))
+    {
+        return true;
+    }
+    if (uthread_spawn(host_main) == FAIL)
+    {
+        _hostStarting = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Moves the coroutines handed over by other threads to the ready queue, oldest first.
+ */
+void CoroutineScheduler::drain_incoming()
+{
+    if (_incoming.load(std::memory_order_relaxed) == nullptr)
+    {
+        return;
+    }
+    CoroutineNode* node = _incoming.exchange(nullptr, std::memory_order_acquire);
+    CoroutineNode* reversed = nullptr;
+    while (node != nullptr)
+    {
+        CoroutineNode* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+    while (reversed != nullptr)
+    {
+        CoroutineNode* next = reversed->next;
+        push_ready(reversed);
+        reversed = next;
+    }
+}
+
+void CoroutineScheduler::release_sleepers()
+{
+    long long now = now_usecs();
+    while (_sleepingCount > 0 && _sleeping[0]->wakeUsecs <= now)
+    {
+        push_ready(pop_sleeping());
+    }
+}
+
+void CoroutineScheduler::push_ready(CoroutineNode* node)
+{
+    node->next = nullptr;
+    if (_readyTail == nullptr)
+    {
+        _readyHead = node;
+    }
+    else
+    {
+        _readyTail->next = node;
+    }
+    _readyTail = node;
+}
+
+CoroutineNode* CoroutineScheduler::pop_ready()
+{
+    CoroutineNode* node = _readyHead;
+    if (node != nullptr)
+    {
+        _readyHead = node->next;
+        if (_readyHead == nullptr)
+        {
+            _readyTail = nullptr;
+        }
+    }
+    return node;
+}
+
+bool CoroutineScheduler::push_sleeping(CoroutineNode* node)
+{
+    if (_sleepingCount == _sleepingCapacity)
+    {
+        size_t capacity = (_sleepingCapacity == 0) ? INITIAL_SLEEPING_CAPACITY :
+                2 * _sleepingCapacity;
+        CoroutineNode** sleeping = (CoroutineNode**) uthread_alloc(capacity *
+                sizeof(CoroutineNode*));
+        if (sleeping == nullptr)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < _sleepingCount; ++i)
+        {
+            sleeping[i] = _sleeping[i];
+        }
+        uthread_free(_sleeping);
+        _sleeping = sleeping;
+        _sleepingCapacity = capacity;
+    }
+
+    size_t i = _sleepingCount++;
+    while (i > 0 && _sleeping[(i - 1) / 2]->wakeUsecs > node->wakeUsecs)
+    {
+        _sleeping[i] = _sleeping[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    _sleeping[i] = node;
+    return true;
+}
+
+CoroutineNode* CoroutineScheduler::pop_sleeping()
+{
+    CoroutineNode* top = _sleeping[0];
+    CoroutineNode* last = _sleeping[--_sleepingCount];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= _sleepingCount)
+        {
+            break;
+        }
+        if (child + 1 < _sleepingCount &&
+            _sleeping[child + 1]->wakeUsecs < _sleeping[child]->wakeUsecs)
+        {
+            ++child;
+        }
+        if (last->wakeUsecs <= _sleeping[child]->wakeUsecs)
+        {
+            break;
+        }
+        _sleeping[i] = _sleeping[child];
+        i = child;
+    }
+    _sleeping[i] = last;
+    return top;
+}
+
+/**
+ * A coroutine spawned on the host goes straight to the ready queue; one spawned elsewhere is
+ * pushed to the incoming stack and the host is unparked to pick it up.
+ */
+bool CoroutineScheduler::spawn(CoroutineNode* node)
+{
+    if (is_host())
+    {
+        push_ready(node);
+        return true;
+    }
+    if (_hostId == FAIL && !start_host())
+    {
+        return false;
+    }
+
+    CoroutineNode* head = _incoming.load(std::memory_order_relaxed);
+    do
+    {
+        node->next = head;
+    } while (!_incoming.compare_exchange_weak(head, node, std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+    // a non-empty stack means its first pusher unparks the host, which drains it whole
+    int host = _hostId;
+    if (head == nullptr && host != FAIL)
+    {
+        uthread_unpark(host);
+    }
+    return true;
+}
+
+bool CoroutineScheduler::sleep(CoroutineNode* node, int usecs)
+{
+    node->wakeUsecs = now_usecs() + usecs;
+    return push_sleeping(node);
+}
+
+/**
+ * The first coroutine to lock takes the library mutex for the host thread, which blocks the host
+ * (and so every coroutine) while a stackful thread holds it. Later coroutines wait in line.
+ */
+bool CoroutineScheduler::lock_mutex(CoroutineNode* node)
+{
+    if (!_mutexHeld)
+    {
+        uthread_mutex_lock();
+        _mutexHeld = true;
+        return true;
+    }
+    node->next = nullptr;
+    if (_mutexWaitersTail == nullptr)
+    {
+        _mutexWaitersHead = node;
+    }
+    else
+    {
+        _mutexWaitersTail->next = node;
+    }
+    _mutexWaitersTail = node;
+    return false;
+}
+
+int CoroutineScheduler::unlock_mutex()
+{
+    if (!_mutexHeld)
+    {
+        return FAIL;
+    }
+    CoroutineNode* next = _mutexWaitersHead;
+    if (next == nullptr)
+    {
+        _mutexHeld = false;
+        return uthread_mutex_unlock();
+    }
+    _mutexWaitersHead = next->next;
+    if (_mutexWaitersHead == nullptr)
+    {
+        _mutexWaitersTail = nullptr;
+    }
+    push_ready(next);
+    return 0;
+}
+
+bool CoroutineScheduler::is_host()
+{
+    return _hostId != FAIL && _hostId == uthread_get_tid();
+}
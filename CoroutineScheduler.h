@@ -0,0 +1,101 @@
+#include <atomic>
+#include <coroutine>
+#include <stddef.h>
+#include "uthreads.h"
+
+#ifndef EX2_OS_COROUTINESCHEDULER_H
+#define EX2_OS_COROUTINESCHEDULER_H
+
+/**
+ * The scheduler's view of a coroutine: every task's promise is one. A coroutine waits in at most
+ * one queue at a time, so the queues link the nodes themselves and never allocate.
+ */
+struct CoroutineNode
+{
+    std::coroutine_handle<> handle;
+    CoroutineNode* next;
+    long long wakeUsecs;
+    bool detached;
+};
+
+/**
+ * Runs stackless coroutines on a single host uthread. The host sits in the library's ready queue
+ * like any other thread and resumes the READY coroutines one after the other while it holds the
+ * CPU; with nothing to run it parks (with a timeout when a coroutine sleeps). Other threads hand
+ * coroutines over through a lock-free stack. Everything else is touched by the host only.
+ */
+class CoroutineScheduler
+{
+private:
+    static std::atomic<int> _hostId;
+    static std::atomic<bool> _hostStarting;
+
+    /**
+     * Coroutines spawned by other threads, newest first.
+     */
+    static std::atomic<CoroutineNode*> _incoming;
+
+    static CoroutineNode* _readyHead;
+    static CoroutineNode* _readyTail;
+
+    /**
+     * A binary min-heap of sleeping coroutines by wake-up time, grown with uthread_alloc.
+     */
+    static CoroutineNode** _sleeping;
+    static size_t _sleepingCount;
+    static size_t _sleepingCapacity;
+
+    /**
+     * Whether a coroutine holds the library mutex. The host thread owns it on the coroutines'
+     * behalf, so it is handed from one coroutine to the next without being unlocked.
+     */
+    static bool _mutexHeld;
+    static CoroutineNode* _mutexWaitersHead;
+    static CoroutineNode* _mutexWaitersTail;
+
+    static void host_main();
+
+    static bool start_host();
+
+    static void drain_incoming();
+
+    static void release_sleepers();
+
+    static void push_ready(CoroutineNode* node);
+
+    static CoroutineNode* pop_ready();
+
+    static bool push_sleeping(CoroutineNode* node);
+
+    static CoroutineNode* pop_sleeping();
+
+public:
+    /**
+     * Queues a new coroutine, starting the host thread on first use.
+     * @return false if the host thread could not be spawned.
+     */
+    static bool spawn(CoroutineNode* node);
+
+    /**
+     * Suspends a coroutine for usecs micro-seconds. Must be called on the host thread.
+     * @return false if the sleep could not be recorded, in which case the coroutine goes on.
+     */
+    static bool sleep(CoroutineNode* node, int usecs);
+
+    /**
+     * Acquires the library mutex for a coroutine, or queues it behind the current holder.
+     * @return true if the coroutine holds the mutex and may go on right away.
+     */
+    static bool lock_mutex(CoroutineNode* node);
+
+    /**
+     * Hands the mutex to the next waiting coroutine, or unlocks the library mutex.
+     * @return 0 on success, -1 if no coroutine holds the mutex.
+     */
+    static int unlock_mutex();
+
+    static bool is_host();
+};
+
+
+#endif //EX2_OS_COROUTINESCHEDULER_H
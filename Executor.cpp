@@ -0,0 +1,175 @@
+#include "Executor.h"
+
+Executor* Executor::_workerExecutors[MAX_THREAD_NUM];
+
+Executor::Executor(int queueCapacity) : _tasks(queueCapacity)
+{
+    _workerCount = 0;
+    _workerIds = nullptr;
+
+    _submitted = 0;
+    _rejected = 0;
+    _completed = 0;
+    _batches = 0;
+    _maxQueueDepth = 0;
+    _totalLatencyNsecs = 0;
+    _maxLatencyNsecs = 0;
+}
+
+Executor::~Executor()
+{
+    for (int i = 0; i < _workerCount; ++i)
+    {
+        if (_workerIds[i] != -1)
+        {
+            _workerExecutors[_workerIds[i]] = nullptr;
+            uthread_terminate(_workerIds[i]);
+        }
+    }
+    delete[] _workerIds;
+}
+
+bool Executor::start(int workerCount)
+{
+    _workerCount = workerCount;
+    _workerIds = new int[workerCount];
+    for (int i = 0; i < workerCount; ++i)
+    {
+        _workerIds[i] = -1;
+    }
+
+    for (int i = 0; i < workerCount; ++i)
+    {
+        int tid = uthread_spawn(worker_main);
+        if (tid == -1)
+        {
+            return false;
+        }
+        _workerIds[i] = tid;
+        _workerExecutors[tid] = this;
+        // the worker parks first thing, so it cannot run before it is registered
+        uthread_unpark(tid);
+    }
+    return true;
+}
+
+bool Executor::isWorker(int tid) const
+{
+    for (int i = 0; i < _workerCount; ++i)
+    {
+        if (_workerIds[i] == tid)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Executor::worker_main()
+{
+    uthread_park();
+    int tid = uthread_get_tid();
+    Executor* executor = _workerExecutors[tid];
+    int index = 0;
+    while (executor->_workerIds[index] != tid)
+    {
+        index++;
+    }
+    executor->run_worker(index);
+}
+
+void Executor::run_worker(int index)
+{
+    for (;;)
+    {
+        if (run_batch(EXECUTOR_BATCH_SIZE) > 0)
+        {
+            continue;
+        }
+
+        _parked.announce(index);
+        bool parked = (run_batch(EXECUTOR_BATCH_SIZE) == 0);
+        if (parked)
+        {
+            uthread_park();
+        }
+        _parked.leave(index, parked);
+    }
+}
+
+/**
+ * Each task's entry is released before the task runs, so submitters get the room back while the
+ * batch is still running.
+ */
+int Executor::run_batch(int maxTasks)
+{
+    size_t pos;
+    int count = _tasks.claim(maxTasks, &pos);
+    if (count == 0)
+    {
+        return 0;
+    }
+    _batches.fetch_add(1, std::memory_order_relaxed);
+
+    for (int i = 0; i < count; ++i)
+    {
+        Task task = _tasks.value(pos + i);
+        unsigned long long latency =
+                (unsigned long long) (ring_now_nsecs() - _tasks.enqueueNsecs(pos + i));
+        _tasks.release(pos + i);
+
+        _totalLatencyNsecs.fetch_add(latency, std::memory_order_relaxed);
+        unsigned long long maxLatency = _maxLatencyNsecs.load(std::memory_order_relaxed);
+        while (latency > maxLatency &&
+               !_maxLatencyNsecs.compare_exchange_weak(maxLatency, latency, std::memory_order_relaxed))
+        {
+        }
+        task.fn(task.arg);
+        _completed.fetch_add(1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+bool Executor::submit(void (*fn)(void*), void* arg)
+{
+    unsigned int depth = _tasks.push(Task{fn, arg});
+    if (depth == 0)
+    {
+        _rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    _submitted.fetch_add(1, std::memory_order_relaxed);
+
+    unsigned int maxDepth = _maxQueueDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth &&
+           !_maxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+    {
+    }
+
+    if (!_parked.empty())
+    {
+        wake_one_worker();
+    }
+    return true;
+}
+
+void Executor::wake_one_worker()
+{
+    int index = _parked.wakeNext(_workerCount);
+    if (index != -1)
+    {
+        uthread_unpark(_workerIds[index]);
+    }
+}
+
+void Executor::getStats(uthread_executor_stats_t* stats) const
+{
+    stats->submitted = _submitted.load();
+    stats->rejected = _rejected.load();
+    stats->completed = _completed.load();
+    stats->batches = _batches.load();
+    stats->queue_depth = _tasks.length();
+    stats->max_queue_depth = _maxQueueDepth.load();
+    stats->total_latency_nsecs = _totalLatencyNsecs.load();
+    stats->max_latency_nsecs = _maxLatencyNsecs.load();
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include "MpmcRing.h"
+#include "uthreads.h"
+#include "uthread_executor.h"
+
+#ifndef EX2_OS_EXECUTOR_H
+#define EX2_OS_EXECUTOR_H
+
+/**
+ * A fixed pool of worker uthreads fed from a bounded lock-free queue (an MpmcRing). Idle workers
+ * park and a submit unparks one of them.
+ */
+class Executor
+{
+private:
+    struct Task
+    {
+        void (*fn)(void*);
+        void* arg;
+    };
+
+    /**
+     * The executor every worker belongs to, by thread ID.
+     */
+    static Executor* _workerExecutors[MAX_THREAD_NUM];
+
+    MpmcRing<Task> _tasks;
+
+    int _workerCount;
+    int* _workerIds;
+    ParkedSet _parked;
+
+    std::atomic<unsigned long long> _submitted;
+    std::atomic<unsigned long long> _rejected;
+    std::atomic<unsigned long long> _completed;
+    std::atomic<unsigned long long> _batches;
+    std::atomic<unsigned int> _maxQueueDepth;
+    std::atomic<unsigned long long> _totalLatencyNsecs;
+    std::atomic<unsigned long long> _maxLatencyNsecs;
+
+    static void worker_main();
+
+    void run_worker(int index);
+
+    /**
+     * Claims up to maxTasks ready tasks with a single compare-and-swap and runs them.
+     * @return the number of tasks run.
+     */
+    int run_batch(int maxTasks);
+
+    void wake_one_worker();
+
+public:
+    Executor(int queueCapacity);
+
+    ~Executor();
+
+    /**
+     * Spawns the workers.
+     * @return false if a worker could not be spawned.
+     */
+    bool start(int workerCount);
+
+    bool submit(void (*fn)(void*), void* arg);
+
+    void getStats(uthread_executor_stats_t* stats) const;
+
+    bool isWorker(int tid) const;
+};
+
+
+#endif //EX2_OS_EXECUTOR_H
@@ -0,0 +1,356 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include "LockProfiler.h"
+#include "Profiler.h"
+
+#define FAIL -1
+#define SUCCESS 0
+#define NANO_SECONDS 1000000000LL
+#define SITE_NAME_WIDTH 40
+
+LockSite* LockProfiler::_sites = nullptr;
+int LockProfiler::_siteCount;
+long long LockProfiler::_droppedAcquisitions;
+LockHold LockProfiler::_topHolds[LOCK_PROFILE_TOP_HOLDS];
+int LockProfiler::_topHoldCount;
+LockSite* LockProfiler::_ownerSite;
+long long LockProfiler::_acquiredNsecs;
+
+long long LockProfiler::now_nsecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NANO_SECONDS + now.tv_nsec;
+}
+
+/**
+ * @return the histogram bucket of a time: floor(log2(nsecs)), 0 for anything under 2 ns.
+ */
+static int bucket_of(long long nsecs)
+{
+    if (nsecs <= 1)
+    {
+        return 0;
+    }
+    int bucket = 63 - __builtin_clzll((unsigned long long) nsecs);
+    return std::min(bucket, LOCK_PROFILE_BUCKETS - 1);
+}
+
+bool LockProfiler::start()
+{
+    if (_sites == nullptr)
+    {
+        _sites = new(std::nothrow) LockSite[LOCK_PROFILE_MAX_SITES];
+        if (_sites == nullptr)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < LOCK_PROFILE_MAX_SITES; ++i)
+    {
+        _sites[i] = LockSite();
+    }
+    _siteCount = 0;
+    _droppedAcquisitions = 0;
+    _topHoldCount = 0;
+    _ownerSite = nullptr;
+    return true;
+}
+
+/**
+ * Looks the call site up by linear probing, adding it if it is new.
+ * @return nullptr if the table is full.
+ */
+LockSite* LockProfiler::find_site(void* address)
+{
+    uintptr_t hash = ((uintptr_t) address >> 2) * 0x9e3779b97f4a7c15ULL;
+    for (int probe = 0; probe < LOCK_PROFILE_MAX_SITES; ++probe)
+    {
+        LockSite* site = &_sites[(hash + probe) & (LOCK_PROFILE_MAX_SITES - 1)];
+        if (site->address == address)
+        {
+            return site;
+        }
+        if (site->address == nullptr)
+        {
+            site->address = address;
+            _siteCount++;
+            return site;
+        }
+    }
+    return nullptr;
+}
+
+void LockProfiler::acquired(void* address, long long waitStartNsecs)
+{
+    long long now = now_nsecs();
+    LockSite* site = find_site(address);
+    _ownerSite = site;
+    _acquiredNsecs = now;
+    if (site == nullptr)
+    {
+        _droppedAcquisitions++;
+        return;
+    }
+    site->acquisitions++;
+    if (waitStartNsecs != 0)
+    {
+        long long wait = now - waitStartNsecs;
+        site->contended++;
+        site->totalWaitNsecs += wait;
+        site->maxWaitNsecs = std::max(site->maxWaitNsecs, wait);
+        site->waitHistogram[bucket_of(wait)]++;
+    }
+}
+
+void LockProfiler::released(int tid)
+{
+    LockSite* site = _ownerSite;
+    if (site == nullptr)
+    {
+        return;
+    }
+    _ownerSite = nullptr;
+    long long hold = now_nsecs() - _acquiredNsecs;
+    site->totalHoldNsecs += hold;
+    site->maxHoldNsecs = std::max(site->maxHoldNsecs, hold);
+    site->holdHistogram[bucket_of(hold)]++;
+    record_hold(hold, site->address, tid);
+}
+
+/**
+ * Keeps the hold if it is among the longest, by insertion into the sorted array.
+ */
+void LockProfiler::record_hold(long long nsecs, void* address, int tid)
+{
+    if (_topHoldCount == LOCK_PROFILE_TOP_HOLDS && nsecs <= _topHolds[_topHoldCount - 1].nsecs)
+    {
+        return;
+    }
+    int i = std::min(_topHoldCount, LOCK_PROFILE_TOP_HOLDS - 1);
+    while (i > 0 && _topHolds[i - 1].nsecs < nsecs)
+    {
+        _topHolds[i] = _topHolds[i - 1];
+        i--;
+    }
+    _topHolds[i] = LockHold{nsecs, address, tid};
+    _topHoldCount = std::min(_topHoldCount + 1, LOCK_PROFILE_TOP_HOLDS);
+}
+
+/**
+ * @return the sites in use, the ones callers waited the longest at first.
+ */
+static std::vector<const LockSite*> sorted_sites(const LockSite* sites)
+{
+    std::vector<const LockSite*> sorted;
+    for (int i = 0; i < LOCK_PROFILE_MAX_SITES; ++i)
+    {
+        if (sites[i].address != nullptr)
+        {
+            sorted.push_back(&sites[i]);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const LockSite* a, const LockSite* b) {
+        if (a->totalWaitNsecs != b->totalWaitNsecs)
+        {
+            return a->totalWaitNsecs > b->totalWaitNsecs;
+        }
+        return a->totalHoldNsecs > b->totalHoldNsecs;
+    });
+    return sorted;
+}
+
+/**
+ * A return address points past its call, so the call site is named after the byte before it.
+ */
+static const std::string& site_name(void* address, std::map<void*, std::string>& names)
+{
+    return Profiler::symbolize((char*) address - 1, names);
+}
+
+/**
+ * Formats a time with a unit that keeps it short, e.g. 512ns, 16.4us, 1.05ms.
+ */
+static std::string format_nsecs(long long nsecs)
+{
+    char text[32];
+    if (nsecs < 1000)
+    {
+        snprintf(text, sizeof(text), "%lldns", nsecs);
+    }
+    else if (nsecs < 1000000)
+    {
+        snprintf(text, sizeof(text), "%.3gus", nsecs / 1e3);
+    }
+    else if (nsecs < NANO_SECONDS)
+    {
+        snprintf(text, sizeof(text), "%.3gms", nsecs / 1e6);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%.3gs", nsecs / 1e9);
+    }
+    return text;
+}
+
+static int dump_histogram(int fd, const char* title, const long long* histogram)
+{
+    if (dprintf(fd, "    %s", title) < 0)
+    {
+        return FAIL;
+    }
+    for (int bucket = 0; bucket < LOCK_PROFILE_BUCKETS; ++bucket)
+    {
+        if (histogram[bucket] != 0 &&
+            dprintf(fd, " [%s,%s):%lld", format_nsecs(1LL << bucket).c_str(),
+                    format_nsecs(1LL << (bucket + 1)).c_str(), histogram[bucket]) < 0)
+        {
+            return FAIL;
+        }
+    }
+    return dprintf(fd, "\n") < 0 ? FAIL : SUCCESS;
+}
+
+int LockProfiler::dump_text(int fd)
+{
+    std::map<void*, std::string> names;
+    std::vector<const LockSite*> sites = sorted_sites(_sites);
+    if (dprintf(fd, "mutex contention by call site, longest total wait first (%d sites, %lld "
+                    "acquires dropped)\n%-*s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                _siteCount, _droppedAcquisitions, SITE_NAME_WIDTH, "site", "acquires",
+                "contended", "wait", "avg wait", "max wait", "hold", "avg hold", "max hold") < 0)
+    {
+        return FAIL;
+    }
+    for (const LockSite* site : sites)
+    {
+        char name[SITE_NAME_WIDTH + 32];
+        snprintf(name, sizeof(name), "%s (%p)", site_name(site->address, names).c_str(), site->address);
+        long long contended = std::max(site->contended, 1LL);
+        long long acquisitions = std::max(site->acquisitions, 1LL);
+        if (dprintf(fd, "%-*s %10lld %10lld %10s %10s %10s %10s %10s %10s\n", SITE_NAME_WIDTH, name,
+                    site->acquisitions, site->contended, format_nsecs(site->totalWaitNsecs).c_str(),
+                    format_nsecs(site->totalWaitNsecs / contended).c_str(),
+                    format_nsecs(site->maxWaitNsecs).c_str(), format_nsecs(site->totalHoldNsecs).c_str(),
+                    format_nsecs(site->totalHoldNsecs / acquisitions).c_str(),
+                    format_nsecs(site->maxHoldNsecs).c_str()) < 0 ||
+            dump_histogram(fd, "wait", site->waitHistogram) == FAIL ||
+            dump_histogram(fd, "hold", site->holdHistogram) == FAIL)
+        {
+            return FAIL;
+        }
+    }
+    if (dprintf(fd, "longest holds\n") < 0)
+    {
+        return FAIL;
+    }
+    for (int i = 0; i < _topHoldCount; ++i)
+    {
+        const LockHold& hold = _topHolds[i];
+        if (dprintf(fd, "%10s  tid %3d  %s (%p)\n", format_nsecs(hold.nsecs).c_str(), hold.tid,
+                    site_name(hold.address, names).c_str(), hold.address) < 0)
+        {
+            return FAIL;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Quotes a symbol name for JSON.
+ */
+static std::string json_string(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ((unsigned char) c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+static std::string json_histogram(const long long* histogram)
+{
+    std::string json = "[";
+    for (int bucket = 0; bucket < LOCK_PROFILE_BUCKETS; ++bucket)
+    {
+        json += (bucket == 0 ? "" : ",") + std::to_string(histogram[bucket]);
+    }
+    return json + "]";
+}
+
+/**
+ * Histogram bucket i counts the times in [2^i, 2^(i+1)) nano-seconds.
+ */
+int LockProfiler::dump_json(int fd)
+{
+    std::map<void*, std::string> names;
+    std::vector<const LockSite*> sites = sorted_sites(_sites);
+    if (dprintf(fd, "{\"dropped_acquisitions\":%lld,\"sites\":[", _droppedAcquisitions) < 0)
+    {
+        return FAIL;
+    }
+    for (size_t i = 0; i < sites.size(); ++i)
+    {
+        const LockSite* site = sites[i];
+        if (dprintf(fd, "%s{\"site\":%s,\"address\":\"%p\",\"acquisitions\":%lld,\"contended\":%lld,"
+                        "\"wait_nsecs\":{\"total\":%lld,\"max\":%lld,\"histogram\":%s},"
+                        "\"hold_nsecs\":{\"total\":%lld,\"max\":%lld,\"histogram\":%s}}",
+                    i == 0 ? "" : ",", json_string(site_name(site->address, names)).c_str(),
+                    site->address, site->acquisitions, site->contended, site->totalWaitNsecs,
+                    site->maxWaitNsecs, json_histogram(site->waitHistogram).c_str(),
+                    site->totalHoldNsecs, site->maxHoldNsecs,
+                    json_histogram(site->holdHistogram).c_str()) < 0)
+        {
+            return FAIL;
+        }
+    }
+    if (dprintf(fd, "],\"longest_holds\":[") < 0)
+    {
+        return FAIL;
+    }
+    for (int i = 0; i < _topHoldCount; ++i)
+    {
+        const LockHold& hold = _topHolds[i];
+        if (dprintf(fd, "%s{\"nsecs\":%lld,\"tid\":%d,\"site\":%s,\"address\":\"%p\"}",
+                    i == 0 ? "" : ",", hold.nsecs, hold.tid,
+                    json_string(site_name(hold.address, names)).c_str(), hold.address) < 0)
+        {
+            return FAIL;
+        }
+    }
+    return dprintf(fd, "]}\n") < 0 ? FAIL : SUCCESS;
+}
+
+int LockProfiler::dump(int fd, bool json)
+{
+    if (_sites == nullptr)
+    {
+        // never started: an empty profile
+        if (!start())
+        {
+            return FAIL;
+        }
+    }
+    return json ? dump_json(fd) : dump_text(fd);
+}
@@ -0,0 +1,98 @@
+#include <stddef.h>
+
+#ifndef EX2_OS_LOCK_PROFILER_H
+#define EX2_OS_LOCK_PROFILER_H
+
+#define LOCK_PROFILE_MAX_SITES 256 /* call sites tracked, a power of 2; acquires at others are dropped */
+#define LOCK_PROFILE_BUCKETS 32 /* histogram bucket i counts times in [2^i, 2^(i+1)) nano-seconds */
+#define LOCK_PROFILE_TOP_HOLDS 16 /* longest single holds kept */
+
+/**
+ * The counters of one call site of uthread_mutex_lock.
+ */
+struct LockSite
+{
+    void* address;
+    long long acquisitions;
+    long long contended;
+    long long totalWaitNsecs;
+    long long maxWaitNsecs;
+    long long totalHoldNsecs;
+    long long maxHoldNsecs;
+    long long waitHistogram[LOCK_PROFILE_BUCKETS];
+    long long holdHistogram[LOCK_PROFILE_BUCKETS];
+};
+
+/**
+ * One of the longest holds of the mutex.
+ */
+struct LockHold
+{
+    long long nsecs;
+    void* address;
+    int tid;
+};
+
+/**
+ * Keeps the counters of the mutex contention profiler. Sites live in a fixed open-addressing
+ * table allocated by start, so recording never allocates. acquired and released run with the
+ * signals blocked, from lock_mutex and unlock_mutex; each reads the clock once.
+ */
+class LockProfiler
+{
+private:
+    static LockSite* _sites;
+    static int _siteCount;
+    static long long _droppedAcquisitions;
+
+    /**
+     * The longest holds, longest first.
+     */
+    static LockHold _topHolds[LOCK_PROFILE_TOP_HOLDS];
+    static int _topHoldCount;
+
+    /**
+     * The site and time the mutex was last acquired at, nullptr when the acquire was not
+     * recorded (the profiler was off, or the site table was full).
+     */
+    static LockSite* _ownerSite;
+    static long long _acquiredNsecs;
+
+    static LockSite* find_site(void* address);
+
+    static void record_hold(long long nsecs, void* address, int tid);
+
+    static int dump_text(int fd);
+
+    static int dump_json(int fd);
+
+public:
+    static long long now_nsecs();
+
+    /**
+     * Discards the previous counters and makes room for new ones.
+     * @return false if the site table could not be allocated.
+     */
+    static bool start();
+
+    /**
+     * Records an acquire at the call site address.
+     * @param waitStartNsecs when the thread started waiting for the mutex, 0 if it did not wait.
+     */
+    static void acquired(void* address, long long waitStartNsecs);
+
+    /**
+     * Records the release of the mutex by tid.
+     */
+    static void released(int tid);
+
+    /**
+     * Writes the sites, the ones callers waited the longest at first, and the longest holds:
+     * as an aligned report when json is false, and as a JSON object otherwise.
+     * @return -1 if writing failed.
+     */
+    static int dump(int fd, bool json);
+};
+
+
+#endif //EX2_OS_LOCK_PROFILER_H
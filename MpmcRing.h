@@ -0,0 +1,246 @@
+#include <atomic>
+#include <stddef.h>
+#include <time.h>
+#include "uthreads.h"
+
+#ifndef EX2_OS_MPMC_RING_H
+#define EX2_OS_MPMC_RING_H
+
+/*
+ * The lock-free pieces shared by Executor and PipelineStage. Since preemption can stop a producer
+ * or consumer anywhere, they use atomics rather than masking signals.
+ */
+
+/**
+ * The clock ring entries are stamped with.
+ */
+inline long long ring_now_nsecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * A bounded multi-producer multi-consumer queue (a Vyukov ring). Every cell carries a sequence
+ * number telling whether it is free for the producer of a position or filled for its consumer.
+ * Consumers claim a run of filled cells with a single compare-and-swap, then release each cell
+ * once they copied it out.
+ */
+template <typename T>
+class MpmcRing
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+        long long enqueueNsecs;
+    };
+
+    Cell* _cells;
+    size_t _mask;
+    std::atomic<size_t> _enqueuePos;
+    std::atomic<size_t> _dequeuePos;
+
+public:
+    /**
+     * Holds at least capacity entries, rounded up to a power of 2.
+     */
+    explicit MpmcRing(int capacity)
+    {
+        size_t size = 1;
+        while (size < (size_t) capacity)
+        {
+            size <<= 1;
+        }
+        _cells = new Cell[size];
+        for (size_t i = 0; i < size; ++i)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        _mask = size - 1;
+        _enqueuePos = 0;
+        _dequeuePos = 0;
+    }
+
+    ~MpmcRing()
+    {
+        delete[] _cells;
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    /**
+     * Queues value, stamped with the time.
+     * @return the number of entries queued right after, 0 if the ring is full.
+     */
+    unsigned int push(const T& value)
+    {
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;)
+        {
+            cell = &_cells[pos & _mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            long diff = (long) sequence - (long) pos;
+            if (diff == 0)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return 0;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->enqueueNsecs = ring_now_nsecs();
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return (unsigned int) (pos + 1 - _dequeuePos.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Claims up to maxCount queued entries, from *pos on.
+     * @return the number claimed, 0 if the ring is empty.
+     */
+    int claim(int maxCount, size_t* pos)
+    {
+        size_t first = _dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            int count = 0;
+            while (count < maxCount &&
+                   _cells[(first + count) & _mask].sequence.load(std::memory_order_acquire) ==
+                   first + count + 1)
+            {
+                count++;
+            }
+            if (count == 0)
+            {
+                return 0;
+            }
+            if (_dequeuePos.compare_exchange_weak(first, first + count, std::memory_order_relaxed))
+            {
+                *pos = first;
+                return count;
+            }
+        }
+    }
+
+    const T& value(size_t pos) const
+    {
+        return _cells[pos & _mask].value;
+    }
+
+    long long enqueueNsecs(size_t pos) const
+    {
+        return _cells[pos & _mask].enqueueNsecs;
+    }
+
+    /**
+     * Hands a claimed cell back to the producers; its value must not be read after.
+     */
+    void release(size_t pos)
+    {
+        _cells[pos & _mask].sequence.store(pos + _mask + 1, std::memory_order_release);
+    }
+
+    unsigned int length() const
+    {
+        return (unsigned int) (_enqueuePos.load() - _dequeuePos.load());
+    }
+};
+
+/**
+ * The uthreads parked on a queue, by index. The handshake: a thread announces its park before it
+ * checks the queue one last time, so whoever makes progress possible either sees it announced
+ * or leaves something for the check to find. Whoever withdraws the announcement first, the
+ * waker or the thread itself, takes care of it: a wake that wins must unpark the thread, and the
+ * thread must take that unpark (see leave) before it may exit.
+ */
+class ParkedSet
+{
+private:
+    std::atomic<bool> _parked[MAX_THREAD_NUM];
+    std::atomic<int> _count;
+    int _nextToWake;
+
+public:
+    ParkedSet() : _count(0), _nextToWake(0)
+    {
+        for (int i = 0; i < MAX_THREAD_NUM; ++i)
+        {
+            _parked[i] = false;
+        }
+    }
+
+    void announce(int index)
+    {
+        _parked[index].store(true);
+        _count++;
+    }
+
+    /**
+     * @return true if the announcement was still there, so no one will unpark for it.
+     */
+    bool withdraw(int index)
+    {
+        bool expected = true;
+        if (_parked[index].compare_exchange_strong(expected, false))
+        {
+            _count--;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Ends the park of the calling thread, announced at index. If a waker withdrew the
+     * announcement first, its unpark is on the way; a thread that did not park waits for it
+     * here, or it could exit first and leave the unpark to a dead or reused ID.
+     * @param parked whether the thread called uthread_park since the announcement.
+     */
+    void leave(int index, bool parked)
+    {
+        if (!withdraw(index) && !parked)
+        {
+            uthread_park();
+        }
+    }
+
+    bool empty() const
+    {
+        return _count.load() == 0;
+    }
+
+    /**
+     * Withdraws one announcement among the first size indexes, scanning round-robin from where
+     * the last one stopped.
+     * @return its index, -1 if none was announced.
+     */
+    int wakeNext(int size)
+    {
+        for (int scanned = 0; scanned < size; ++scanned)
+        {
+            int index = _nextToWake;
+            _nextToWake = (_nextToWake + 1) % size;
+            if (withdraw(index))
+            {
+                return index;
+            }
+        }
+        return -1;
+    }
+};
+
+
+#endif //EX2_OS_MPMC_RING_H
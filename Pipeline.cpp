@@ -0,0 +1,387 @@
+#include "Pipeline.h"
+
+#define NO_WORKER -1
+#define RESERVED_SLOT -2 /* claimed by setThreadCount, the worker is being spawned */
+
+PipelineStage* PipelineStage::_workerStages[MAX_THREAD_NUM];
+int PipelineStage::_workerSlots[MAX_THREAD_NUM];
+
+PipelineStage::PipelineStage(uthread_stage_fn fn, void* arg, int queueCapacity, int batchSize) :
+        _items(queueCapacity)
+{
+    _fn = fn;
+    _arg = arg;
+    _batchSize = batchSize;
+
+    for (int i = 0; i < MAX_THREAD_NUM; ++i)
+    {
+        _workerIds[i] = NO_WORKER;
+        _batchBuffers[i] = nullptr;
+    }
+    _slotCount = 0;
+    _workerCount = 0;
+    _retiring = 0;
+
+    _enqueued = 0;
+    _dequeued = 0;
+    _processed = 0;
+    _batches = 0;
+    _producerParks = 0;
+    _maxQueueLength = 0;
+    _totalLatencyNsecs = 0;
+    _maxLatencyNsecs = 0;
+}
+
+PipelineStage::~PipelineStage()
+{
+    for (int slot = 0; slot < _slotCount; ++slot)
+    {
+        int tid = _workerIds[slot];
+        if (tid >= 0)
+        {
+            _workerStages[tid] = nullptr;
+            uthread_terminate(tid);
+        }
+        delete[] _batchBuffers[slot];
+    }
+}
+
+bool PipelineStage::spawn_worker()
+{
+    int slot = 0;
+    for (;; ++slot)
+    {
+        if (slot == MAX_THREAD_NUM)
+        {
+            return false;
+        }
+        int expected = NO_WORKER;
+        if (_workerIds[slot].compare_exchange_strong(expected, RESERVED_SLOT))
+        {
+            break;
+        }
+    }
+    if (_batchBuffers[slot] == nullptr)
+    {
+        _batchBuffers[slot] = new void*[UTHREAD_PIPELINE_MAX_BATCH];
+    }
+    int tid = uthread_spawn(worker_main);
+    if (tid == -1)
+    {
+        _workerIds[slot] = NO_WORKER;
+        return false;
+    }
+    _workerStages[tid] = this;
+    _workerSlots[tid] = slot;
+    _workerIds[slot] = tid;
+    _workerCount++;
+    int slotCount = _slotCount.load();
+    while (slot >= slotCount && !_slotCount.compare_exchange_weak(slotCount, slot + 1))
+    {
+    }
+    // the worker parks first thing, so it cannot run before it is registered
+    uthread_unpark(tid);
+    return true;
+}
+
+/**
+ * Lowering the count only asks that many workers to retire: each one exits between batches, so
+ * no batch is cut short. Raising it first takes back retirements that were not carried out yet.
+ */
+bool PipelineStage::setThreadCount(int threadCount)
+{
+    int current = _workerCount - _retiring;
+    if (threadCount < current)
+    {
+        _retiring += current - threadCount;
+        wake_all_workers();
+        return true;
+    }
+    while (current < threadCount)
+    {
+        int retiring = _retiring.load();
+        if (retiring > 0)
+        {
+            if (_retiring.compare_exchange_weak(retiring, retiring - 1))
+            {
+                current++;
+            }
+            continue;
+        }
+        if (!spawn_worker())
+        {
+            return false;
+        }
+        current++;
+    }
+    return true;
+}
+
+void PipelineStage::setBatchSize(int batchSize)
+{
+    _batchSize.store(batchSize, std::memory_order_relaxed);
+}
+
+bool PipelineStage::isWorker(int tid) const
+{
+    for (int slot = 0; slot < _slotCount; ++slot)
+    {
+        if (_workerIds[slot] == tid)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PipelineStage::worker_main()
+{
+    uthread_park();
+    int tid = uthread_get_tid();
+    _workerStages[tid]->run_worker(_workerSlots[tid]);
+}
+
+bool PipelineStage::take_retirement()
+{
+    int retiring = _retiring.load();
+    while (retiring > 0)
+    {
+        if (_retiring.compare_exchange_weak(retiring, retiring - 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PipelineStage::run_worker(int slot)
+{
+    for (;;)
+    {
+        if (take_retirement())
+        {
+            int tid = uthread_get_tid();
+            _workerStages[tid] = nullptr;
+            _workerCount--;
+            // past this point the stage may be destroyed, the slot is no longer this thread's
+            _workerIds[slot] = NO_WORKER;
+            uthread_terminate(tid);
+        }
+        if (run_batch(slot) > 0)
+        {
+            continue;
+        }
+
+        _parked.announce(slot);
+        // a wake withdrawn by now must reach this worker before it may retire
+        bool parked = (_retiring.load() == 0 && run_batch(slot) == 0);
+        if (parked)
+        {
+            uthread_park();
+        }
+        _parked.leave(slot, parked);
+    }
+}
+
+/**
+ * The items are copied out and their entries freed before the handler runs, so producers get the
+ * room back while the batch is still being handled. One timestamp serves the whole batch.
+ */
+int PipelineStage::run_batch(int slot)
+{
+    size_t pos;
+    int count = _items.claim(_batchSize.load(std::memory_order_relaxed), &pos);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    void** batch = _batchBuffers[slot];
+    long long now = ring_now_nsecs();
+    unsigned long long totalLatency = 0;
+    unsigned long long batchMaxLatency = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        batch[i] = _items.value(pos + i);
+        unsigned long long latency = (unsigned long long) (now - _items.enqueueNsecs(pos + i));
+        _items.release(pos + i);
+        totalLatency += latency;
+        if (latency > batchMaxLatency)
+        {
+            batchMaxLatency = latency;
+        }
+    }
+    _batches.fetch_add(1, std::memory_order_relaxed);
+    _dequeued.fetch_add(count, std::memory_order_relaxed);
+    _totalLatencyNsecs.fetch_add(totalLatency, std::memory_order_relaxed);
+    unsigned long long maxLatency = _maxLatencyNsecs.load(std::memory_order_relaxed);
+    while (batchMaxLatency > maxLatency &&
+           !_maxLatencyNsecs.compare_exchange_weak(maxLatency, batchMaxLatency, std::memory_order_relaxed))
+    {
+    }
+    if (!_parkedProducers.empty())
+    {
+        wake_producers(count);
+    }
+
+    _fn(batch, count, _arg);
+    _processed.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+bool PipelineStage::try_enqueue(void* item)
+{
+    unsigned int length = _items.push(item);
+    if (length == 0)
+    {
+        return false;
+    }
+    _enqueued.fetch_add(1, std::memory_order_relaxed);
+
+    unsigned int maxLength = _maxQueueLength.load(std::memory_order_relaxed);
+    while (length > maxLength &&
+           !_maxQueueLength.compare_exchange_weak(maxLength, length, std::memory_order_relaxed))
+    {
+    }
+
+    if (!_parked.empty())
+    {
+        wake_one_worker();
+    }
+    return true;
+}
+
+/**
+ * Same handshake as the workers': the producer announces the park before it retries, so a
+ * dequeue either sees it parked or leaves room for the retry.
+ */
+void PipelineStage::enqueue(void* item)
+{
+    int tid = -1;
+    while (!try_enqueue(item))
+    {
+        if (tid == -1)
+        {
+            tid = uthread_get_tid();
+        }
+        _parkedProducers.announce(tid);
+        bool queued = try_enqueue(item);
+        if (!queued)
+        {
+            _producerParks.fetch_add(1, std::memory_order_relaxed);
+            uthread_park();
+        }
+        _parkedProducers.leave(tid, !queued);
+        if (queued)
+        {
+            return;
+        }
+    }
+}
+
+void PipelineStage::wake_one_worker()
+{
+    int slot = _parked.wakeNext(_slotCount.load());
+    if (slot != -1)
+    {
+        uthread_unpark(_workerIds[slot]);
+    }
+}
+
+void PipelineStage::wake_all_workers()
+{
+    int slotCount = _slotCount.load();
+    for (int slot = 0; slot < slotCount; ++slot)
+    {
+        if (_parked.withdraw(slot))
+        {
+            uthread_unpark(_workerIds[slot]);
+        }
+    }
+}
+
+/**
+ * Unparks up to count parked producers, one per freed entry.
+ */
+void PipelineStage::wake_producers(int count)
+{
+    for (int tid = 0; tid < MAX_THREAD_NUM && count > 0; ++tid)
+    {
+        if (_parkedProducers.withdraw(tid))
+        {
+            uthread_unpark(tid);
+            count--;
+        }
+    }
+}
+
+void PipelineStage::getStats(uthread_pipeline_stage_stats_t* stats) const
+{
+    stats->enqueued = _enqueued.load();
+    stats->dequeued = _dequeued.load();
+    stats->processed = _processed.load();
+    stats->batches = _batches.load();
+    stats->producer_parks = _producerParks.load();
+    stats->queue_length = _items.length();
+    stats->max_queue_length = _maxQueueLength.load();
+    stats->batch_size = (unsigned int) _batchSize.load();
+    stats->threads = (unsigned int) (_workerCount.load() - _retiring.load());
+    stats->total_latency_nsecs = _totalLatencyNsecs.load();
+    stats->max_latency_nsecs = _maxLatencyNsecs.load();
+}
+
+Pipeline::Pipeline()
+{
+    for (int i = 0; i < UTHREAD_PIPELINE_MAX_STAGES; ++i)
+    {
+        _stages[i] = nullptr;
+    }
+    _stageCount = 0;
+}
+
+Pipeline::~Pipeline()
+{
+    for (int i = 0; i < _stageCount; ++i)
+    {
+        delete _stages[i];
+    }
+}
+
+int Pipeline::addStage(uthread_stage_fn fn, void* arg, int threadCount, int queueCapacity, int batchSize)
+{
+    int index = _stageCount.load();
+    if (index == UTHREAD_PIPELINE_MAX_STAGES)
+    {
+        return -1;
+    }
+    PipelineStage* stage = new PipelineStage(fn, arg, queueCapacity, batchSize);
+    if (!stage->setThreadCount(threadCount))
+    {
+        delete stage;
+        return -1;
+    }
+    _stages[index] = stage;
+    _stageCount.store(index + 1);
+    return index;
+}
+
+PipelineStage* Pipeline::getStage(int stage) const
+{
+    if (stage < 0 || stage >= _stageCount.load())
+    {
+        return nullptr;
+    }
+    return _stages[stage];
+}
+
+bool Pipeline::isWorker(int tid) const
+{
+    for (int i = 0; i < _stageCount; ++i)
+    {
+        if (_stages[i]->isWorker(tid))
+        {
+            return true;
+        }
+    }
+    return false;
+}
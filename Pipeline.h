@@ -0,0 +1,133 @@
+#include <atomic>
+#include "MpmcRing.h"
+#include "uthreads.h"
+#include "uthread_pipeline.h"
+
+#ifndef EX2_OS_PIPELINE_H
+#define EX2_OS_PIPELINE_H
+
+/**
+ * One stage of a pipeline: a bounded lock-free queue (an MpmcRing) and the worker uthreads
+ * draining it. Workers are kept in slots so the set can grow and shrink while
+ * the stage runs; a worker that is asked to retire frees its own slot between batches. Idle
+ * workers park and an enqueue unparks one of them; producers that find the queue full park and
+ * a dequeue unparks as many of them as it freed entries.
+ */
+class PipelineStage
+{
+private:
+    /**
+     * The stage and slot every worker belongs to, by thread ID.
+     */
+    static PipelineStage* _workerStages[MAX_THREAD_NUM];
+    static int _workerSlots[MAX_THREAD_NUM];
+
+    MpmcRing<void*> _items;
+
+    uthread_stage_fn _fn;
+    void* _arg;
+    std::atomic<int> _batchSize;
+
+    /**
+     * The worker in every slot (-1 for a free slot), its batch buffer, and the parked ones.
+     */
+    std::atomic<int> _workerIds[MAX_THREAD_NUM];
+    void** _batchBuffers[MAX_THREAD_NUM];
+    ParkedSet _parked;
+    std::atomic<int> _slotCount;
+    std::atomic<int> _workerCount;
+    std::atomic<int> _retiring;
+
+    /**
+     * Producers parked on the full queue, by thread ID.
+     */
+    ParkedSet _parkedProducers;
+
+    std::atomic<unsigned long long> _enqueued;
+    std::atomic<unsigned long long> _dequeued;
+    std::atomic<unsigned long long> _processed;
+    std::atomic<unsigned long long> _batches;
+    std::atomic<unsigned long long> _producerParks;
+    std::atomic<unsigned int> _maxQueueLength;
+    std::atomic<unsigned long long> _totalLatencyNsecs;
+    std::atomic<unsigned long long> _maxLatencyNsecs;
+
+    static void worker_main();
+
+    void run_worker(int slot);
+
+    /**
+     * @return true if the calling worker took one of the pending retirements.
+     */
+    bool take_retirement();
+
+    bool spawn_worker();
+
+    bool try_enqueue(void* item);
+
+    /**
+     * Claims up to the batch size queued items with a single compare-and-swap, frees their
+     * entries and hands them to the handler.
+     * @return the number of items handled.
+     */
+    int run_batch(int slot);
+
+    void wake_one_worker();
+
+    void wake_all_workers();
+
+    void wake_producers(int count);
+
+public:
+    PipelineStage(uthread_stage_fn fn, void* arg, int queueCapacity, int batchSize);
+
+    ~PipelineStage();
+
+    /**
+     * Spawns or retires workers until threadCount of them are left.
+     * @return false if a worker could not be spawned.
+     */
+    bool setThreadCount(int threadCount);
+
+    void setBatchSize(int batchSize);
+
+    /**
+     * Queues item, parking the calling thread while the queue is full.
+     */
+    void enqueue(void* item);
+
+    void getStats(uthread_pipeline_stage_stats_t* stats) const;
+
+    bool isWorker(int tid) const;
+};
+
+/**
+ * The stages of a pipeline, in order.
+ */
+class Pipeline
+{
+private:
+    PipelineStage* _stages[UTHREAD_PIPELINE_MAX_STAGES];
+    std::atomic<int> _stageCount;
+
+public:
+    Pipeline();
+
+    ~Pipeline();
+
+    /**
+     * @return the number of the new stage, or -1 if the pipeline is full or the workers could not
+     * be spawned.
+     */
+    int addStage(uthread_stage_fn fn, void* arg, int threadCount, int queueCapacity, int batchSize);
+
+    /**
+     * @return the stage, or nullptr if it does not exist.
+     */
+    PipelineStage* getStage(int stage) const;
+
+    bool isWorker(int tid) const;
+};
+
+
+#endif //EX2_OS_PIPELINE_H
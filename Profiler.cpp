@@ -0,0 +1,190 @@
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <ucontext.h>
+#include <map>
+#include <new>
+#include <string>
+#include "Profiler.h"
+
+#define FAIL -1
+#define SUCCESS 0
+
+ProfileSample* Profiler::_samples = nullptr;
+int Profiler::_sampleCount;
+long long Profiler::_dropped;
+char* Profiler::_mainStackLow;
+char* Profiler::_mainStackHigh;
+
+bool Profiler::start()
+{
+    if (_samples == nullptr)
+    {
+        _samples = new(std::nothrow) ProfileSample[PROFILE_MAX_SAMPLES];
+        if (_samples == nullptr)
+        {
+            return false;
+        }
+    }
+    _sampleCount = 0;
+    _dropped = 0;
+
+    pthread_attr_t attr;
+    void* low;
+    size_t size;
+    _mainStackLow = nullptr;
+    _mainStackHigh = nullptr;
+    if (pthread_getattr_np(pthread_self(), &attr) == SUCCESS)
+    {
+        if (pthread_attr_getstack(&attr, &low, &size) == SUCCESS)
+        {
+            _mainStackLow = (char*) low;
+            _mainStackHigh = (char*) low + size;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    return true;
+}
+
+/**
+ * A frame pointer is only followed while it points into the stack, upwards, so code built
+ * without frame pointers ends the walk early instead of faulting.
+ */
+void Profiler::record(Thread* thread, void* context)
+{
+    if (_samples == nullptr)
+    {
+        return;
+    }
+    if (_sampleCount == PROFILE_MAX_SAMPLES)
+    {
+        _dropped++;
+        return;
+    }
+    ProfileSample& sample = _samples[_sampleCount];
+    sample.tid = thread->getId();
+    sample.entry = thread->getEntry();
+    sample.depth = 0;
+
+#ifdef __x86_64__
+    ucontext_t* uc = (ucontext_t*) context;
+    sample.frames[sample.depth++] = (void*) uc->uc_mcontext.gregs[REG_RIP];
+
+    const char* low = thread->getStackBase();
+    const char* high = low + thread->getStackSize();
+    if (thread->getEntry() == nullptr)
+    {
+        low = _mainStackLow;
+        high = _mainStackHigh;
+    }
+    uintptr_t* frame = (uintptr_t*) uc->uc_mcontext.gregs[REG_RBP];
+    while (sample.depth < PROFILE_MAX_DEPTH && low != nullptr &&
+           (const char*) frame >= low && (const char*) (frame + 2) <= high &&
+           ((uintptr_t) frame % sizeof(uintptr_t)) == 0)
+    {
+        void* ret = (void*) frame[1];
+        if (ret == nullptr)
+        {
+            break;
+        }
+        sample.frames[sample.depth++] = ret;
+        uintptr_t* next = (uintptr_t*) frame[0];
+        if (next <= frame)
+        {
+            break;
+        }
+        frame = next;
+    }
+#else
+    (void) context;
+#endif
+    _sampleCount++;
+}
+
+/**
+ * Names a code address after its symbol when the dynamic symbol table has it, and otherwise as
+ * module+offset, which addr2line resolves.
+ */
+const std::string& Profiler::symbolize(void* address, std::map<void*, std::string>& names)
+{
+    auto known = names.find(address);
+    if (known != names.end())
+    {
+        return known->second;
+    }
+    char name[512];
+    Dl_info info;
+    bool found = dladdr(address, &info) != 0;
+    if (found && info.dli_sname != nullptr)
+    {
+        snprintf(name, sizeof(name), "%s", info.dli_sname);
+    }
+    else if (found && info.dli_fname != nullptr)
+    {
+        const char* module = info.dli_fname;
+        for (const char* c = info.dli_fname; *c; ++c)
+        {
+            if (*c == '/')
+            {
+                module = c + 1;
+            }
+        }
+        snprintf(name, sizeof(name), "%s+0x%lx", module,
+                 (unsigned long) ((char*) address - (char*) info.dli_fbase));
+    }
+    else
+    {
+        snprintf(name, sizeof(name), "0x%lx", (unsigned long) address);
+    }
+    return names[address] = name;
+}
+
+int Profiler::dump(int fd)
+{
+    std::map<void*, std::string> names;
+    std::map<std::string, int> stacks;
+    for (int i = 0; i < _sampleCount; ++i)
+    {
+        const ProfileSample& sample = _samples[i];
+        std::string stack = "uthread-" + std::to_string(sample.tid) + ";";
+        std::string root = (sample.entry == nullptr) ? std::string("main") :
+                           symbolize((void*) sample.entry, names);
+        stack += root;
+        for (int depth = sample.depth - 1; depth >= 0; --depth)
+        {
+            // a return address points past its call, which may already be the next function
+            void* address = sample.frames[depth];
+            if (depth > 0)
+            {
+                address = (char*) address - 1;
+            }
+            const std::string& name = symbolize(address, names);
+            // the entry function's own frame repeats the root
+            if (depth == sample.depth - 1 && depth > 0 && name == root)
+            {
+                continue;
+            }
+            stack += ";" + name;
+        }
+        stacks[stack]++;
+    }
+    for (auto& stack : stacks)
+    {
+        if (dprintf(fd, "%s %d\n", stack.first.c_str(), stack.second) < 0)
+        {
+            return FAIL;
+        }
+    }
+    return SUCCESS;
+}
+
+int Profiler::getSampleCount()
+{
+    return _sampleCount;
+}
+
+long long Profiler::getDropped()
+{
+    return _dropped;
+}
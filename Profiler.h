@@ -0,0 +1,73 @@
+#include <stddef.h>
+#include <map>
+#include <string>
+#include "Thread.h"
+
+#ifndef EX2_OS_PROFILER_H
+#define EX2_OS_PROFILER_H
+
+#define PROFILE_MAX_DEPTH 32 /* frames kept per sample, the interrupted PC included */
+#define PROFILE_MAX_SAMPLES 32768 /* samples kept until the next start, later ones are dropped */
+
+/**
+ * One stack sample, innermost frame first.
+ */
+struct ProfileSample
+{
+    int tid;
+    ThreadEntry entry;
+    int depth;
+    void* frames[PROFILE_MAX_DEPTH];
+};
+
+/**
+ * Keeps the samples of the sampling profiler. record runs inside signal handlers, so it only
+ * writes to the buffer allocated by start; everything else runs outside them with the profiling
+ * signals blocked.
+ */
+class Profiler
+{
+private:
+    static ProfileSample* _samples;
+    static int _sampleCount;
+    static long long _dropped;
+
+    /**
+     * The main thread runs on the process stack, whose bounds are looked up once at start.
+     */
+    static char* _mainStackLow;
+    static char* _mainStackHigh;
+
+public:
+    /**
+     * Discards the previous samples and makes room for new ones.
+     * @return false if the buffer could not be allocated.
+     */
+    static bool start();
+
+    /**
+     * Samples the thread that a signal interrupted: its PC and the frame-pointer chain from the
+     * interrupted frame, as far as it stays within the thread's stack.
+     * @param context the ucontext_t the signal handler got.
+     */
+    static void record(Thread* thread, void* context);
+
+    /**
+     * Writes the samples in folded-stack format: one line per distinct stack, outermost frame
+     * first, under a "uthread-<tid>;<entry>" root, followed by its sample count.
+     * @return -1 if writing failed.
+     */
+    static int dump(int fd);
+
+    /**
+     * Names a code address, caching the names in names.
+     */
+    static const std::string& symbolize(void* address, std::map<void*, std::string>& names);
+
+    static int getSampleCount();
+
+    static long long getDropped();
+};
+
+
+#endif //EX2_OS_PROFILER_H
@@ -0,0 +1,278 @@
+#include "uthreads.h"
+#include "Thread.h"
+
+#ifndef EX2_OS_SCHEDPOLICY_H
+#define EX2_OS_SCHEDPOLICY_H
+
+/*
+ * The best-effort ready queue, picked at build time (the UTHREADS_SCHED_POLICY CMake option).
+ * Every policy has the same non-virtual interface, so sync_handler calls straight into the one
+ * compiled in and the switch path inlines fully. The queues are fixed arrays of thread IDs and
+ * never allocate.
+ */
+
+/**
+ * Round-robin: READY threads run in the order they became READY, and a preempted thread goes to
+ * the back of the line.
+ */
+class RoundRobinPolicy
+{
+public:
+    /**
+     * Whether the running thread is preempted when its quantum ends.
+     */
+    static const bool TIME_SLICED = true;
+
+    /**
+     * Whether woken should take the CPU from running as soon as it becomes READY.
+     */
+    static bool preempts(const Thread* woken, const Thread* running)
+    {
+        (void) woken;
+        (void) running;
+        return false;
+    }
+
+    /**
+     * Whether a queued thread should run before thread, which is not queued.
+     */
+    bool outranks(const Thread* thread) const
+    {
+        (void) thread;
+        return false;
+    }
+
+    RoundRobinPolicy() : _head(0), _count(0)
+    {
+    }
+
+    bool empty() const
+    {
+        return _count == 0;
+    }
+
+    int size() const
+    {
+        return _count;
+    }
+
+    /**
+     * Queues a thread that became READY.
+     */
+    void push(Thread* thread)
+    {
+        _ids[(_head + _count++) % MAX_THREAD_NUM] = thread->getId();
+    }
+
+    /**
+     * Queues the running thread when its quantum ends.
+     */
+    void pushPreempted(Thread* thread)
+    {
+        push(thread);
+    }
+
+    /**
+     * Takes the next thread to run. The queue must not be empty.
+     * @return its ID.
+     */
+    int pop()
+    {
+        int id = _ids[_head];
+        _head = (_head + 1) % MAX_THREAD_NUM;
+        _count--;
+        return id;
+    }
+
+    /**
+     * Takes a thread out of the queue when it blocks or terminates.
+     * @return false if it was not queued.
+     */
+    bool remove(Thread* thread)
+    {
+        for (int i = 0; i < _count; ++i)
+        {
+            if (_ids[(_head + i) % MAX_THREAD_NUM] == thread->getId())
+            {
+                for (; i + 1 < _count; ++i)
+                {
+                    _ids[(_head + i) % MAX_THREAD_NUM] = _ids[(_head + i + 1) % MAX_THREAD_NUM];
+                }
+                _count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Takes every thread whose ID is marked in leaving out of the queue in a single pass.
+     */
+    void removeMarked(const bool leaving[])
+    {
+        int kept = 0;
+        for (int i = 0; i < _count; ++i)
+        {
+            int id = _ids[(_head + i) % MAX_THREAD_NUM];
+            if (!leaving[id])
+            {
+                _ids[(_head + kept++) % MAX_THREAD_NUM] = id;
+            }
+        }
+        _count = kept;
+    }
+
+    void clear()
+    {
+        _head = 0;
+        _count = 0;
+    }
+
+protected:
+    void pushFront(Thread* thread)
+    {
+        _head = (_head + MAX_THREAD_NUM - 1) % MAX_THREAD_NUM;
+        _ids[_head] = thread->getId();
+        _count++;
+    }
+
+private:
+    int _ids[MAX_THREAD_NUM];
+    int _head;
+    int _count;
+};
+
+/**
+ * FIFO: a thread keeps the CPU until it blocks, yields or terminates. The quantum timer is only
+ * armed for deadline and sleep bookkeeping, and a thread interrupted by it is resumed first.
+ */
+class FifoPolicy : public RoundRobinPolicy
+{
+public:
+    static const bool TIME_SLICED = false;
+
+    void pushPreempted(Thread* thread)
+    {
+        pushFront(thread);
+    }
+};
+
+/**
+ * Fixed priorities: the highest non-empty level runs first, round-robin within a level, and a
+ * thread woken above the running one takes the CPU right away. Threads are filed under their
+ * effective priority, so sync_handler requeues a READY thread whose priority changes. A bitmap
+ * of the non-empty levels makes picking the next thread one bit scan.
+ */
+class PriorityPolicy
+{
+public:
+    static const bool TIME_SLICED = true;
+
+    static bool preempts(const Thread* woken, const Thread* running)
+    {
+        return woken->getEffectivePriority() > running->getEffectivePriority();
+    }
+
+    bool outranks(const Thread* thread) const
+    {
+        return _nonEmpty != 0 &&
+               HIGHEST_BIT - __builtin_clz(_nonEmpty) > thread->getEffectivePriority();
+    }
+
+    PriorityPolicy() : _nonEmpty(0)
+    {
+    }
+
+    bool empty() const
+    {
+        return _nonEmpty == 0;
+    }
+
+    int size() const
+    {
+        int size = 0;
+        for (unsigned int levels = _nonEmpty; levels != 0; levels &= levels - 1)
+        {
+            size += _levels[__builtin_ctz(levels)].size();
+        }
+        return size;
+    }
+
+    void push(Thread* thread)
+    {
+        int level = thread->getEffectivePriority();
+        _levels[level].push(thread);
+        _nonEmpty |= 1u << level;
+    }
+
+    void pushPreempted(Thread* thread)
+    {
+        push(thread);
+    }
+
+    int pop()
+    {
+        int level = HIGHEST_BIT - __builtin_clz(_nonEmpty);
+        int id = _levels[level].pop();
+        if (_levels[level].empty())
+        {
+            _nonEmpty &= ~(1u << level);
+        }
+        return id;
+    }
+
+    bool remove(Thread* thread)
+    {
+        int level = thread->getEffectivePriority();
+        if (!_levels[level].remove(thread))
+        {
+            return false;
+        }
+        if (_levels[level].empty())
+        {
+            _nonEmpty &= ~(1u << level);
+        }
+        return true;
+    }
+
+    void removeMarked(const bool leaving[])
+    {
+        for (int level = 0; level < UTHREAD_PRIORITY_LEVELS; ++level)
+        {
+            if (_nonEmpty & (1u << level))
+            {
+                _levels[level].removeMarked(leaving);
+                if (_levels[level].empty())
+                {
+                    _nonEmpty &= ~(1u << level);
+                }
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (int level = 0; level < UTHREAD_PRIORITY_LEVELS; ++level)
+        {
+            _levels[level].clear();
+        }
+        _nonEmpty = 0;
+    }
+
+private:
+    static const int HIGHEST_BIT = 31;
+
+    RoundRobinPolicy _levels[UTHREAD_PRIORITY_LEVELS];
+    unsigned int _nonEmpty;
+};
+
+#if defined(UTHREADS_POLICY_PRIORITY)
+typedef PriorityPolicy SchedPolicy;
+#elif defined(UTHREADS_POLICY_FIFO)
+typedef FifoPolicy SchedPolicy;
+#else
+typedef RoundRobinPolicy SchedPolicy;
+#endif
+
+
+#endif //EX2_OS_SCHEDPOLICY_H
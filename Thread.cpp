@@ -1,76 +1,513 @@
-#include <iostream>
-#include <signal.h>
-#include "Thread.h"
-
-#ifdef __x86_64__
-/* code for 64 bit Intel arch */
-
-typedef unsigned long address_t;
-#define JB_SP 6
-#define JB_PC 7
-
-/* A translation is required when using an address of a variable.
-   Use this as a black box in your code. */
-address_t translate_address(address_t addr)
-{
-    address_t ret;
-    asm volatile("xor    %%fs:0x30,%0\n"
-                 "rol    $0x11,%0\n"
-    : "=g" (ret)
-    : "0" (addr));
-    return ret;
-}
-#else
-#endif
-
-//TODO: CHRCK IF THERE IS A NEED TO MAKE A DIFF BETWEEN THREAD[0] TO THE REST
-Thread::Thread(int id, void (*f)(void))
-{
-    _id = id;
-    _state = READY;
-    _quantumCount = 0;
-    _stack = new char[STACK_SIZE];
-
-    address_t sp, pc;
-    sp = (address_t)_stack + STACK_SIZE - sizeof(address_t);
-    pc = (address_t) f;
-    sigsetjmp(_env, 1);
-    (_env->__jmpbuf)[JB_SP] = translate_address(sp);
-    (_env->__jmpbuf)[JB_PC] = translate_address(pc);
-    sigemptyset(&_env->__saved_mask);
-}
-
-Thread::~Thread()
-{
-    delete[] _stack;
-}
-
-int Thread::getId() const
-{
-    return _id;
-}
-
-void Thread::setState(int state)
-{
-    _state = state;
-}
-
-int Thread::getState() const
-{
-    return _state;
-}
-
-void Thread::increaseQuantumCount()
-{
-    _quantumCount++;
-}
-
-int Thread::getQuantumCount() const
-{
-    return _quantumCount;
-}
-
-__jmp_buf_tag* Thread::getEnv()
-{
-    return _env;
+#include <iostream>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include "Thread.h"
+
+#ifdef __x86_64__
+/* code for 64 bit Intel arch */
+
+typedef unsigned long address_t;
+#define JB_SP 6
+#define JB_PC 7
+
+/* A translation is required when using an address of a variable.
+   Use this as a black box in your code. */
+address_t translate_address(address_t addr)
+{
+    address_t ret;
+    asm volatile("xor    %%fs:0x30,%0\n"
+                 "rol    $0x11,%0\n"
+    : "=g" (ret)
+    : "0" (addr));
+    return ret;
+}
+#else
+#endif
+
+/**
+ * Preemption signals are delivered on the running thread's stack, so every stack gets room for one
+ * kernel signal frame (which holds the full vector register state) on top of STACK_SIZE.
+ */
+static size_t stack_allocation_size()
+{
+#ifdef _SC_MINSIGSTKSZ
+    long signalFrame = sysconf(_SC_MINSIGSTKSZ);
+    if (signalFrame > 0)
+    {
+        return STACK_SIZE + (size_t) signalFrame;
+    }
+#endif
+    return STACK_SIZE + MINSIGSTKSZ;
+}
+
+//TODO: CHRCK IF THERE IS A NEED TO MAKE A DIFF BETWEEN THREAD[0] TO THE REST
+Thread::Thread(int id, void (*f)(void))
+{
+    _id = id;
+    _state = READY;
+    _quantumCount = 0;
+    _quantumUsecs = 0;
+    _exhaustScore = LATENCY_SENSITIVE_SCORE;
+    _avgRunUsecs = 0;
+    _weight = DEFAULT_WEIGHT;
+    _priority = DEFAULT_PRIORITY;
+    _inheritedPriority = NO_INHERITED_PRIORITY;
+    _boostCount = 0;
+    _boostStartUsecs = 0;
+    _boostedUsecs = 0;
+    _vruntime = 0;
+    _periodUsecs = 0;
+    _budgetUsecs = 0;
+    _budgetLeftUsecs = 0;
+    _deadlineUsecs = 0;
+    _deadlineMisses = 0;
+    _quotaUsecs = 0;
+    _quotaPeriodUsecs = 0;
+    _quotaLeftUsecs = 0;
+    _quotaPeriodEndUsecs = 0;
+    _throttleCount = 0;
+    _throttleStartUsecs = 0;
+    _throttledUsecs = 0;
+    _rcuNesting = 0;
+    for (int key = 0; key < UTHREAD_KEYS_INLINE; ++key)
+    {
+        _specific[key] = nullptr;
+    }
+    _specificOverflow = nullptr;
+    _parked = false;
+    _parkPermit = false;
+    _wakeUsecs = 0;
+    _group = NO_GROUP;
+    _groupIndex = 0;
+    _entry = f;
+    _stackPainted = false;
+    _stackSize = stack_allocation_size();
+    _stack = new char[_stackSize];
+
+    address_t sp, pc;
+    sp = (address_t)_stack + _stackSize - sizeof(address_t);
+    pc = (address_t) f;
+    sigsetjmp(_env, 1);
+    (_env->__jmpbuf)[JB_SP] = translate_address(sp);
+    (_env->__jmpbuf)[JB_PC] = translate_address(pc);
+    sigemptyset(&_env->__saved_mask);
+}
+
+Thread::~Thread()
+{
+    delete[] _stack;
+    delete _specificOverflow;
+}
+
+int Thread::getId() const
+{
+    return _id;
+}
+
+void Thread::setState(int state)
+{
+    _state = state;
+}
+
+int Thread::getState() const
+{
+    return _state;
+}
+
+void Thread::increaseQuantumCount()
+{
+    _quantumCount++;
+}
+
+int Thread::getQuantumCount() const
+{
+    return _quantumCount;
+}
+
+void Thread::setQuantumUsecs(int quantum_usecs)
+{
+    _quantumUsecs = quantum_usecs;
+}
+
+int Thread::getQuantumUsecs() const
+{
+    return _quantumUsecs;
+}
+
+void Thread::recordRun(int runUsecs, bool exhaustedQuantum)
+{
+    int sample = exhaustedQuantum ? EXHAUST_SCORE_MAX : 0;
+    _exhaustScore += (sample - _exhaustScore) >> RUN_HISTORY_SHIFT;
+    _avgRunUsecs += (runUsecs - _avgRunUsecs) >> RUN_HISTORY_SHIFT;
+}
+
+int Thread::getAvgRunUsecs() const
+{
+    return _avgRunUsecs;
+}
+
+bool Thread::isLatencySensitive() const
+{
+    return _exhaustScore < LATENCY_SENSITIVE_SCORE;
+}
+
+void Thread::setWeight(int weight)
+{
+    _weight = weight;
+}
+
+int Thread::getWeight() const
+{
+    return _weight;
+}
+
+void Thread::setPriority(int priority, long long nowUsecs)
+{
+    _priority = priority;
+    updateBoost(nowUsecs);
+}
+
+int Thread::getPriority() const
+{
+    return _priority;
+}
+
+void Thread::setInheritedPriority(int priority, long long nowUsecs)
+{
+    if (priority > getEffectivePriority())
+    {
+        _boostCount++;
+    }
+    _inheritedPriority = priority;
+    updateBoost(nowUsecs);
+}
+
+int Thread::getInheritedPriority() const
+{
+    return _inheritedPriority;
+}
+
+int Thread::getEffectivePriority() const
+{
+    return (_inheritedPriority > _priority) ? _inheritedPriority : _priority;
+}
+
+int Thread::getBoostCount() const
+{
+    return _boostCount;
+}
+
+long long Thread::getBoostedUsecs(long long nowUsecs) const
+{
+    if (_boostStartUsecs != 0)
+    {
+        return _boostedUsecs + nowUsecs - _boostStartUsecs;
+    }
+    return _boostedUsecs;
+}
+
+/**
+ * Starts or stops the boost clock when the inherited priority moves above or below the thread's own.
+ */
+void Thread::updateBoost(long long nowUsecs)
+{
+    bool boosted = _inheritedPriority > _priority;
+    if (boosted && _boostStartUsecs == 0)
+    {
+        _boostStartUsecs = nowUsecs;
+    }
+    else if (!boosted && _boostStartUsecs != 0)
+    {
+        _boostedUsecs += nowUsecs - _boostStartUsecs;
+        _boostStartUsecs = 0;
+    }
+}
+
+void Thread::chargeRuntime(int runUsecs)
+{
+    _vruntime += (unsigned long long) runUsecs * VRUNTIME_SCALE / _weight;
+}
+
+void Thread::setVruntime(unsigned long long vruntime)
+{
+    _vruntime = vruntime;
+}
+
+unsigned long long Thread::getVruntime() const
+{
+    return _vruntime;
+}
+
+void Thread::setDeadlineParams(int periodUsecs, int budgetUsecs, long long nowUsecs)
+{
+    _periodUsecs = periodUsecs;
+    _budgetUsecs = budgetUsecs;
+    _budgetLeftUsecs = budgetUsecs;
+    _deadlineUsecs = nowUsecs + periodUsecs;
+}
+
+bool Thread::isDeadlineThread() const
+{
+    return _periodUsecs > 0;
+}
+
+bool Thread::hasBudget() const
+{
+    return _periodUsecs > 0 && _budgetLeftUsecs > 0;
+}
+
+int Thread::getPeriodUsecs() const
+{
+    return _periodUsecs;
+}
+
+int Thread::getBudgetUsecs() const
+{
+    return _budgetUsecs;
+}
+
+int Thread::getBudgetLeftUsecs() const
+{
+    return _budgetLeftUsecs;
+}
+
+long long Thread::getDeadlineUsecs() const
+{
+    return _deadlineUsecs;
+}
+
+void Thread::chargeBudget(int runUsecs)
+{
+    _budgetLeftUsecs -= runUsecs;
+}
+
+void Thread::startNextJob()
+{
+    _deadlineUsecs += _periodUsecs;
+    _budgetLeftUsecs = _budgetUsecs;
+}
+
+void Thread::increaseDeadlineMisses()
+{
+    _deadlineMisses++;
+}
+
+int Thread::getDeadlineMisses() const
+{
+    return _deadlineMisses;
+}
+
+void Thread::setCpuQuota(int quotaUsecs, int periodUsecs, long long nowUsecs)
+{
+    _quotaUsecs = quotaUsecs;
+    _quotaPeriodUsecs = periodUsecs;
+    _quotaLeftUsecs = quotaUsecs;
+    _quotaPeriodEndUsecs = nowUsecs + periodUsecs;
+}
+
+bool Thread::hasCpuQuota() const
+{
+    return _quotaPeriodUsecs > 0;
+}
+
+int Thread::getQuotaLeftUsecs() const
+{
+    return _quotaLeftUsecs;
+}
+
+long long Thread::getQuotaPeriodEndUsecs() const
+{
+    return _quotaPeriodEndUsecs;
+}
+
+void Thread::refillQuota(long long nowUsecs)
+{
+    if (_quotaPeriodUsecs == 0 || nowUsecs < _quotaPeriodEndUsecs)
+    {
+        return;
+    }
+    // periods keep their phase, however many of them went by
+    long long periods = (nowUsecs - _quotaPeriodEndUsecs) / _quotaPeriodUsecs + 1;
+    _quotaPeriodEndUsecs += periods * _quotaPeriodUsecs;
+    _quotaLeftUsecs = _quotaUsecs;
+}
+
+void Thread::chargeQuota(int runUsecs)
+{
+    _quotaLeftUsecs -= runUsecs;
+}
+
+bool Thread::isOverQuota() const
+{
+    return _quotaPeriodUsecs > 0 && _quotaLeftUsecs <= 0;
+}
+
+void Thread::startThrottle(long long nowUsecs)
+{
+    _throttleCount++;
+    _throttleStartUsecs = nowUsecs;
+}
+
+void Thread::endThrottle(long long nowUsecs)
+{
+    _throttledUsecs += nowUsecs - _throttleStartUsecs;
+    _throttleStartUsecs = 0;
+}
+
+int Thread::getThrottleCount() const
+{
+    return _throttleCount;
+}
+
+long long Thread::getThrottledUsecs(long long nowUsecs) const
+{
+    if (_throttleStartUsecs != 0)
+    {
+        return _throttledUsecs + (nowUsecs - _throttleStartUsecs);
+    }
+    return _throttledUsecs;
+}
+
+void Thread::increaseRcuNesting()
+{
+    _rcuNesting++;
+}
+
+void Thread::decreaseRcuNesting()
+{
+    _rcuNesting--;
+}
+
+int Thread::getRcuNesting() const
+{
+    return _rcuNesting;
+}
+
+void* Thread::getSpecific(int key) const
+{
+    if (key < UTHREAD_KEYS_INLINE)
+    {
+        return _specific[key];
+    }
+    size_t index = key - UTHREAD_KEYS_INLINE;
+    if (_specificOverflow == nullptr || index >= _specificOverflow->size())
+    {
+        return nullptr;
+    }
+    return (*_specificOverflow)[index];
+}
+
+void Thread::setSpecific(int key, void* value)
+{
+    if (key < UTHREAD_KEYS_INLINE)
+    {
+        _specific[key] = value;
+        return;
+    }
+    size_t index = key - UTHREAD_KEYS_INLINE;
+    if (_specificOverflow == nullptr)
+    {
+        _specificOverflow = new std::vector<void*>();
+    }
+    if (index >= _specificOverflow->size())
+    {
+        _specificOverflow->resize(index + 1, nullptr);
+    }
+    (*_specificOverflow)[index] = value;
+}
+
+Arena* Thread::getArena()
+{
+    return &_arena;
+}
+
+void Thread::setParked(bool parked)
+{
+    _parked = parked;
+}
+
+bool Thread::isParked() const
+{
+    return _parked;
+}
+
+void Thread::setParkPermit(bool permit)
+{
+    _parkPermit = permit;
+}
+
+bool Thread::hasParkPermit() const
+{
+    return _parkPermit;
+}
+
+void Thread::setWakeUsecs(long long wakeUsecs)
+{
+    _wakeUsecs = wakeUsecs;
+}
+
+long long Thread::getWakeUsecs() const
+{
+    return _wakeUsecs;
+}
+
+void Thread::setGroup(int group, size_t index)
+{
+    _group = group;
+    _groupIndex = index;
+}
+
+int Thread::getGroup() const
+{
+    return _group;
+}
+
+size_t Thread::getGroupIndex() const
+{
+    return _groupIndex;
+}
+
+ThreadEntry Thread::getEntry() const
+{
+    return _entry;
+}
+
+void Thread::paintStack()
+{
+    memset(_stack, STACK_CANARY, _stackSize);
+    _stackPainted = true;
+}
+
+bool Thread::isStackPainted() const
+{
+    return _stackPainted;
+}
+
+const char* Thread::getStackBase() const
+{
+    return _stack;
+}
+
+size_t Thread::getStackSize() const
+{
+    return _stackSize;
+}
+
+/**
+ * The stack grows down from its top, so the untouched bytes are the ones at the low end.
+ */
+size_t Thread::getStackPeak() const
+{
+    size_t untouched = 0;
+    while (untouched < _stackSize && _stack[untouched] == STACK_CANARY)
+    {
+        untouched++;
+    }
+    return _stackSize - untouched;
+}
+
+__jmp_buf_tag* Thread::getEnv()
+{
+    return _env;
 }
\ No newline at end of file
@@ -1,44 +1,311 @@
-
-#include <setjmp.h>
-#include "uthreads.h"
-
-#ifndef EX2_OS_THREAD_H
-#define EX2_OS_THREAD_H
-
-#define RUNNING 0
-#define READY 1
-#define BLOCKED 2
-#define BLOCKED_MUTEX 3
-#define BLOCKED_AND_BLOCKED_MUTEX 4
-
-class Thread
-
-{
-private:
-    int _id;
-    int _state;
-    char* _stack;
-    sigjmp_buf _env;
-    int _quantumCount;
-
-public:
-    Thread(int id, void (*f)(void)); // TODO check if need distractor
-
-    ~Thread();
-
-    int getId() const;
-
-    void setState(int new_state);
-
-    int getState() const; // TODO go over all places where threads differ by state change
-    // according to BLOCKED_MUTEX & BLOCKED_AND_BLOCKED_MUTEX
-
-    void increaseQuantumCount();
-
-    int getQuantumCount() const;
-
-    __jmp_buf_tag* getEnv();
-};
-
-
-#endif //EX2_OS_THREAD_H
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <vector>
+#include "uthreads.h"
+#include "Arena.h"
+
+#ifndef EX2_OS_THREAD_H
+#define EX2_OS_THREAD_H
+
+#define RUNNING 0
+#define READY 1
+#define BLOCKED 2
+#define BLOCKED_MUTEX 3
+#define BLOCKED_AND_BLOCKED_MUTEX 4
+#define WAITING_PERIOD 5
+#define THROTTLED 6 /* used up its CPU quota, waits for the next quota period */
+
+#define EXHAUST_SCORE_MAX 256 /* fixed-point 1.0 for the exhausted-quantum average */
+#define LATENCY_SENSITIVE_SCORE 128 /* below this a thread usually gives up the CPU early */
+#define RUN_HISTORY_SHIFT 2 /* recent runs weigh 1/4 in the averages */
+
+#define DEFAULT_WEIGHT 1
+#define DEFAULT_PRIORITY 0
+#define NO_INHERITED_PRIORITY -1
+#define NO_GROUP -1
+#define VRUNTIME_SCALE 1024 /* keeps precision when dividing run time by large weights */
+#define STACK_CANARY ((char) 0xA5) /* fill of a profiled stack, bytes still holding it were never used */
+
+typedef void (*ThreadEntry)(void);
+
+class Thread
+
+{
+private:
+    int _id;
+    int _state;
+    char* _stack;
+    size_t _stackSize;
+    ThreadEntry _entry;
+    bool _stackPainted;
+    sigjmp_buf _env;
+    int _quantumCount;
+    int _quantumUsecs;
+    int _exhaustScore;
+    int _avgRunUsecs;
+    int _weight;
+    int _priority;
+    int _inheritedPriority;
+    int _boostCount;
+    long long _boostStartUsecs;
+    long long _boostedUsecs;
+    unsigned long long _vruntime;
+    int _periodUsecs;
+    int _budgetUsecs;
+    int _budgetLeftUsecs;
+    long long _deadlineUsecs;
+    int _deadlineMisses;
+    int _quotaUsecs;
+    int _quotaPeriodUsecs;
+    int _quotaLeftUsecs;
+    long long _quotaPeriodEndUsecs;
+    int _throttleCount;
+    long long _throttleStartUsecs;
+    long long _throttledUsecs;
+    int _rcuNesting;
+    void* _specific[UTHREAD_KEYS_INLINE];
+    std::vector<void*>* _specificOverflow;
+    Arena _arena;
+    bool _parked;
+    bool _parkPermit;
+    long long _wakeUsecs;
+    int _group;
+    size_t _groupIndex;
+
+public:
+    Thread(int id, void (*f)(void)); // TODO check if need distractor
+
+    ~Thread();
+
+    int getId() const;
+
+    void setState(int new_state);
+
+    int getState() const; // TODO go over all places where threads differ by state change
+    // according to BLOCKED_MUTEX & BLOCKED_AND_BLOCKED_MUTEX
+
+    void increaseQuantumCount();
+
+    int getQuantumCount() const;
+
+    void setQuantumUsecs(int quantum_usecs);
+
+    int getQuantumUsecs() const;
+
+    /**
+     * Folds the last time slice into the thread's recent behavior.
+     * @param runUsecs how long the thread ran.
+     * @param exhaustedQuantum true if it was preempted, false if it blocked.
+     */
+    void recordRun(int runUsecs, bool exhaustedQuantum);
+
+    int getAvgRunUsecs() const;
+
+    bool isLatencySensitive() const;
+
+    void setWeight(int weight);
+
+    int getWeight() const;
+
+    /**
+     * Sets the priority the thread was given, the one it drops back to when it stops inheriting.
+     */
+    void setPriority(int priority, long long nowUsecs);
+
+    int getPriority() const;
+
+    /**
+     * Sets the priority lent to the thread by the threads waiting for the mutex it holds,
+     * NO_INHERITED_PRIORITY when none is.
+     */
+    void setInheritedPriority(int priority, long long nowUsecs);
+
+    int getInheritedPriority() const;
+
+    /**
+     * @return the priority the thread is scheduled at, the higher of its own and the inherited one.
+     */
+    int getEffectivePriority() const;
+
+    /**
+     * @return how many times an inherited priority raised the thread's effective priority.
+     */
+    int getBoostCount() const;
+
+    /**
+     * @return how long the thread has run at an inherited priority above its own, the current
+     * boost included.
+     */
+    long long getBoostedUsecs(long long nowUsecs) const;
+
+    /**
+     * Charges run time to the thread's virtual runtime, scaled down by its weight.
+     */
+    void chargeRuntime(int runUsecs);
+
+    void setVruntime(unsigned long long vruntime);
+
+    unsigned long long getVruntime() const;
+
+    /**
+     * Puts the thread in the deadline class (or takes it out when periodUsecs is 0), with its
+     * first job released at nowUsecs.
+     */
+    void setDeadlineParams(int periodUsecs, int budgetUsecs, long long nowUsecs);
+
+    bool isDeadlineThread() const;
+
+    /**
+     * @return true if the thread is in the deadline class and its current job has budget left.
+     */
+    bool hasBudget() const;
+
+    int getPeriodUsecs() const;
+
+    int getBudgetUsecs() const;
+
+    int getBudgetLeftUsecs() const;
+
+    /**
+     * The absolute deadline (CLOCK_MONOTONIC, micro-seconds) of the current job. While the thread
+     * is WAITING_PERIOD this is also the release time of its next job.
+     */
+    long long getDeadlineUsecs() const;
+
+    void chargeBudget(int runUsecs);
+
+    /**
+     * Releases the next job: moves the deadline one period on and refills the budget.
+     */
+    void startNextJob();
+
+    void increaseDeadlineMisses();
+
+    int getDeadlineMisses() const;
+
+    /**
+     * Limits the thread to quotaUsecs of run time in every periodUsecs, the first period starting
+     * at nowUsecs, or lifts the limit when periodUsecs is 0.
+     */
+    void setCpuQuota(int quotaUsecs, int periodUsecs, long long nowUsecs);
+
+    bool hasCpuQuota() const;
+
+    int getQuotaLeftUsecs() const;
+
+    /**
+     * When the current quota period ends (CLOCK_MONOTONIC, micro-seconds), which is also when a
+     * THROTTLED thread may run again.
+     */
+    long long getQuotaPeriodEndUsecs() const;
+
+    /**
+     * Refills the quota if the current period is over, moving on to the period nowUsecs is in.
+     * Run time over the quota is forgiven, not carried over.
+     */
+    void refillQuota(long long nowUsecs);
+
+    void chargeQuota(int runUsecs);
+
+    /**
+     * @return true if the thread has a quota and used it up for the current period.
+     */
+    bool isOverQuota() const;
+
+    /**
+     * Marks the start and end of a stretch of time THROTTLED.
+     */
+    void startThrottle(long long nowUsecs);
+
+    void endThrottle(long long nowUsecs);
+
+    int getThrottleCount() const;
+
+    /**
+     * @return how long the thread has been THROTTLED, the current stretch included.
+     */
+    long long getThrottledUsecs(long long nowUsecs) const;
+
+    /**
+     * Depth of the RCU read-side critical sections the thread is in. The thread holds no RCU
+     * references while it is 0.
+     */
+    void increaseRcuNesting();
+
+    void decreaseRcuNesting();
+
+    int getRcuNesting() const;
+
+    /**
+     * @return the thread's value for a uthread-local storage key, NULL if it has none.
+     */
+    void* getSpecific(int key) const;
+
+    /**
+     * Keys from UTHREAD_KEYS_INLINE on live in an overflow area that may have to grow here.
+     */
+    void setSpecific(int key, void* value);
+
+    Arena* getArena();
+
+    void setParked(bool parked);
+
+    bool isParked() const;
+
+    void setParkPermit(bool permit);
+
+    bool hasParkPermit() const;
+
+    /**
+     * When a sleeping or timed-parked thread is due to wake up (CLOCK_MONOTONIC, micro-seconds),
+     * 0 if it is not waiting on a timeout.
+     */
+    void setWakeUsecs(long long wakeUsecs);
+
+    long long getWakeUsecs() const;
+
+    /**
+     * The thread group the thread belongs to, NO_GROUP if none, and its slot in the group's
+     * member list.
+     */
+    void setGroup(int group, size_t index);
+
+    int getGroup() const;
+
+    size_t getGroupIndex() const;
+
+    /**
+     * The function the thread was spawned with, nullptr for the main thread.
+     */
+    ThreadEntry getEntry() const;
+
+    /**
+     * Fills the unused stack with STACK_CANARY so getStackPeak can find how deep it went.
+     * Must be called before the thread first runs.
+     */
+    void paintStack();
+
+    bool isStackPainted() const;
+
+    /**
+     * The lowest address of the thread's stack, which grows down from getStackBase() + getStackSize().
+     */
+    const char* getStackBase() const;
+
+    size_t getStackSize() const;
+
+    /**
+     * Scans a painted stack from its far end for the first byte that was written.
+     * @return the most bytes of stack the thread has used so far, signal frames included.
+     */
+    size_t getStackPeak() const;
+
+    __jmp_buf_tag* getEnv();
+
+private:
+    void updateBoost(long long nowUsecs);
+};
+
+
+#endif //EX2_OS_THREAD_H
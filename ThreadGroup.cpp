@@ -0,0 +1,57 @@
+#include "ThreadGroup.h"
+
+ThreadGroup::ThreadGroup(int id)
+{
+    _id = id;
+    _quantumCount = 0;
+    _cpuUsecs = 0;
+}
+
+int ThreadGroup::getId() const
+{
+    return _id;
+}
+
+void ThreadGroup::addMember(Thread* thread)
+{
+    thread->setGroup(_id, _members.size());
+    _members.push_back(thread);
+}
+
+/**
+ * Moves the last member into the leaving thread's slot.
+ */
+void ThreadGroup::removeMember(Thread* thread)
+{
+    size_t index = thread->getGroupIndex();
+    Thread* last = _members.back();
+    _members[index] = last;
+    last->setGroup(_id, index);
+    _members.pop_back();
+    thread->setGroup(NO_GROUP, 0);
+}
+
+const std::vector<Thread*>& ThreadGroup::getMembers() const
+{
+    return _members;
+}
+
+void ThreadGroup::increaseQuantumCount()
+{
+    _quantumCount++;
+}
+
+int ThreadGroup::getQuantumCount() const
+{
+    return _quantumCount;
+}
+
+void ThreadGroup::chargeRuntime(int runUsecs)
+{
+    _cpuUsecs += runUsecs;
+}
+
+long long ThreadGroup::getCpuUsecs() const
+{
+    return _cpuUsecs;
+}
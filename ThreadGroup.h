@@ -0,0 +1,44 @@
+#include <vector>
+#include "Thread.h"
+
+#ifndef EX2_OS_THREADGROUP_H
+#define EX2_OS_THREADGROUP_H
+
+/**
+ * A set of threads controlled together, with the quantums and CPU time of its members added up.
+ * The counters keep what terminated members used.
+ */
+class ThreadGroup
+{
+private:
+    int _id;
+
+    /**
+     * Every member knows its slot here, so a member leaves in O(1).
+     */
+    std::vector<Thread*> _members;
+    int _quantumCount;
+    long long _cpuUsecs;
+
+public:
+    explicit ThreadGroup(int id);
+
+    int getId() const;
+
+    void addMember(Thread* thread);
+
+    void removeMember(Thread* thread);
+
+    const std::vector<Thread*>& getMembers() const;
+
+    void increaseQuantumCount();
+
+    int getQuantumCount() const;
+
+    void chargeRuntime(int runUsecs);
+
+    long long getCpuUsecs() const;
+};
+
+
+#endif //EX2_OS_THREADGROUP_H
@@ -0,0 +1,112 @@
+/*
+ * Bulk API benchmark.
+ * Spawns, blocks and resumes batches of threads with the *_many calls and
+ * with one call per thread, and reports the cost per thread of each step as
+ * the batch grows. The threads never run: the quantum is long enough that the
+ * main thread is not preempted while it measures.
+ * Usage: bench_bulk [rounds]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include "uthreads.h"
+
+#define MAX_BATCH 64
+
+static void idle_thread()
+{
+    for (;;)
+    {
+        uthread_park();
+    }
+}
+
+static long long now_nsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+
+    if (uthread_init(1000000) != 0)
+    {
+        return 1;
+    }
+
+    void (*fns[MAX_BATCH])(void);
+    for (int i = 0; i < MAX_BATCH; ++i)
+    {
+        fns[i] = idle_thread;
+    }
+    int tids[MAX_BATCH];
+
+    printf("%6s %8s %12s %12s %12s\n", "batch", "mode", "spawn ns", "block ns", "resume ns");
+    for (int batch = 1; batch <= MAX_BATCH; batch *= 2)
+    {
+        for (int bulk = 0; bulk <= 1; ++bulk)
+        {
+            long long spawnNsecs = 0;
+            long long blockNsecs = 0;
+            long long resumeNsecs = 0;
+            for (int round = 0; round < rounds; ++round)
+            {
+                long long start = now_nsecs();
+                if (bulk)
+                {
+                    uthread_spawn_many(fns, batch, tids);
+                }
+                else
+                {
+                    for (int i = 0; i < batch; ++i)
+                    {
+                        tids[i] = uthread_spawn(idle_thread);
+                    }
+                }
+                long long spawned = now_nsecs();
+                if (bulk)
+                {
+                    uthread_block_many(tids, batch);
+                }
+                else
+                {
+                    for (int i = 0; i < batch; ++i)
+                    {
+                        uthread_block(tids[i]);
+                    }
+                }
+                long long blocked = now_nsecs();
+                if (bulk)
+                {
+                    uthread_resume_many(tids, batch);
+                }
+                else
+                {
+                    for (int i = 0; i < batch; ++i)
+                    {
+                        uthread_resume(tids[i]);
+                    }
+                }
+                long long resumed = now_nsecs();
+
+                spawnNsecs += spawned - start;
+                blockNsecs += blocked - spawned;
+                resumeNsecs += resumed - blocked;
+                for (int i = 0; i < batch; ++i)
+                {
+                    uthread_terminate(tids[i]);
+                }
+            }
+            long long threads = (long long) rounds * batch;
+            printf("%6d %8s %12.1f %12.1f %12.1f\n", batch, bulk ? "many" : "single",
+                   (double) spawnNsecs / threads, (double) blockNsecs / threads,
+                   (double) resumeNsecs / threads);
+        }
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Coroutine benchmark.
+ * Spawns many stackless tasks next to a pool of stackful threads. Each task
+ * joins a child task, sleeps and then updates a counter under the library
+ * mutex, so all the tasks are alive at once while they sleep.
+ * Usage: bench_coroutines [tasks] [stackful_threads] [sleep_usecs] [quantum_usecs]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include "uthreads.h"
+#include "uthread_task.h"
+
+static volatile long done = 0;
+static long counter = 0;
+static volatile bool stop = false;
+static int sleepUsecs;
+
+static double now_secs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uthread::task<long> child(long i)
+{
+    co_return i % 7;
+}
+
+static uthread::task<> work(long i)
+{
+    long value = co_await child(i);
+    co_await uthread::sleep_for(sleepUsecs);
+    co_await uthread::mutex_lock();
+    counter += value;
+    uthread::mutex_unlock();
+    done = done + 1;
+}
+
+static void stackful()
+{
+    while (!stop)
+    {
+        uthread_sleep(1000);
+    }
+    uthread_park();
+}
+
+int main(int argc, char* argv[])
+{
+    long tasks = argc > 1 ? atol(argv[1]) : 1000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 64;
+    sleepUsecs = argc > 3 ? atoi(argv[3]) : 10000;
+    int quantum = argc > 4 ? atoi(argv[4]) : 1000;
+
+    if (uthread_init_with_timer(quantum, UTHREAD_TIMER_MONOTONIC) != 0)
+    {
+        return 1;
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        if (uthread_spawn(stackful) == -1)
+        {
+            return 1;
+        }
+    }
+
+    double start = now_secs();
+    for (long i = 0; i < tasks; ++i)
+    {
+        if (uthread::co_spawn(work(i)) != 0)
+        {
+            return 1;
+        }
+    }
+    double spawned = now_secs() - start;
+    while (done < tasks)
+    {
+        uthread_sleep(1000);
+    }
+    double elapsed = now_secs() - start;
+    stop = true;
+
+    long expected = 0;
+    for (long i = 0; i < tasks; ++i)
+    {
+        expected += i % 7;
+    }
+    printf("tasks=%ld stackful=%d sleep=%dus quantum=%dus: spawn %.0f ns/task, "
+           "%.2f Mtasks/s, counter %s\n", tasks, threads, sleepUsecs, quantum,
+           spawned * 1e9 / tasks, tasks / elapsed / 1e6,
+           (counter == expected) ? "ok" : "WRONG");
+    uthread_terminate(0);
+    return 0;
+}
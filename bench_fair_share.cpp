@@ -0,0 +1,67 @@
+/*
+ * Weighted fair-share benchmark.
+ * Runs CPU-bound threads of two tenants under UTHREAD_SCHED_FAIR, tenant A's
+ * threads with weight 3 and tenant B's with weight 1, and reports the share of
+ * quantums and of loop iterations each tenant achieved.
+ * Usage: bench_fair_share [threads_per_tenant] [quantums] [quantum_usecs]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "uthreads.h"
+
+#define WEIGHT_A 3
+#define WEIGHT_B 1
+
+static volatile unsigned long long iterations[MAX_THREAD_NUM];
+
+static void worker()
+{
+    volatile unsigned long long* counter = &iterations[uthread_get_tid()];
+    for (;;)
+    {
+        (*counter)++;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int perTenant = argc > 1 ? atoi(argv[1]) : 4;
+    int quantums = argc > 2 ? atoi(argv[2]) : 4000;
+    int quantum = argc > 3 ? atoi(argv[3]) : 200;
+
+    if (uthread_init_with_timer(quantum, UTHREAD_TIMER_MONOTONIC) != 0 ||
+        uthread_set_sched_policy(UTHREAD_SCHED_FAIR) != 0)
+    {
+        return 1;
+    }
+
+    int tenantA[MAX_THREAD_NUM];
+    int tenantB[MAX_THREAD_NUM];
+    for (int i = 0; i < perTenant; ++i)
+    {
+        tenantA[i] = uthread_spawn(worker);
+        uthread_set_weight(tenantA[i], WEIGHT_A);
+        tenantB[i] = uthread_spawn(worker);
+        uthread_set_weight(tenantB[i], WEIGHT_B);
+    }
+
+    while (uthread_get_total_quantums() < quantums)
+    {
+    }
+
+    long long quantumsA = 0, quantumsB = 0;
+    unsigned long long itersA = 0, itersB = 0;
+    for (int i = 0; i < perTenant; ++i)
+    {
+        quantumsA += uthread_get_quantums(tenantA[i]);
+        quantumsB += uthread_get_quantums(tenantB[i]);
+        itersA += iterations[tenantA[i]];
+        itersB += iterations[tenantB[i]];
+    }
+    printf("threads/tenant=%d weights=%d:%d quantums A=%lld B=%lld ratio=%.2f iterations ratio=%.2f\n",
+           perTenant, WEIGHT_A, WEIGHT_B, quantumsA, quantumsB, (double) quantumsA / quantumsB,
+           (double) itersA / itersB);
+    uthread_terminate(0);
+    return 0;
+}
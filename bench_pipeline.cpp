@@ -0,0 +1,160 @@
+/*
+ * Three-stage pipeline benchmark (parse -> enrich -> serialize) for uthread_pipeline.
+ * The main thread feeds records into the first stage, parking whenever it is full, and each stage
+ * hands its batch on to the next one. Every batch size runs in its own process and reports the
+ * records per second and, per stage, the average batch, the average and longest queueing
+ * latency, the longest queue and how often producers parked. The last run starts the enrich
+ * stage with one worker and rebalances it to the given thread count halfway through.
+ * Usage: bench_pipeline [records [threads_per_stage [quantum_usecs]]]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "uthreads.h"
+#include "uthread_pipeline.h"
+
+#define STAGES 3
+#define RECORD_BYTES 64
+#define MAIN_SLEEP_USECS 1000
+
+struct Record
+{
+    unsigned int key;
+    unsigned int checksum;
+    char payload[RECORD_BYTES];
+};
+
+static const char* stageNames[STAGES] = {"parse", "enrich", "serialize"};
+static uthread_pipeline_t* pipeline;
+static volatile long serialized;
+static volatile unsigned long long sink;
+
+static double now_secs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void parse(void** items, int count, void* arg)
+{
+    (void) arg;
+    for (int i = 0; i < count; ++i)
+    {
+        Record* record = (Record*) items[i];
+        for (int b = 0; b < RECORD_BYTES; ++b)
+        {
+            record->payload[b] = (char) (record->key + b);
+        }
+        uthread_pipeline_enqueue(pipeline, 1, record);
+    }
+}
+
+static void enrich(void** items, int count, void* arg)
+{
+    (void) arg;
+    for (int i = 0; i < count; ++i)
+    {
+        Record* record = (Record*) items[i];
+        unsigned int checksum = 0;
+        for (int b = 0; b < RECORD_BYTES; ++b)
+        {
+            checksum = checksum * 31 + (unsigned char) record->payload[b];
+        }
+        record->checksum = checksum;
+        uthread_pipeline_enqueue(pipeline, 2, record);
+    }
+}
+
+static void serialize(void** items, int count, void* arg)
+{
+    (void) arg;
+    unsigned long long sum = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        sum += ((Record*) items[i])->checksum;
+    }
+    sink += sum;
+    serialized += count;
+}
+
+static int run(long records, int threads, int batch, bool rebalance, int quantum)
+{
+    if (uthread_init(quantum) != 0)
+    {
+        return 1;
+    }
+    pipeline = uthread_pipeline_create();
+    uthread_stage_fn handlers[STAGES] = {parse, enrich, serialize};
+    for (int stage = 0; stage < STAGES; ++stage)
+    {
+        int stageThreads = (rebalance && stage == 1) ? 1 : threads;
+        if (uthread_pipeline_add_stage(pipeline, handlers[stage], nullptr, stageThreads, 1024, batch) != stage)
+        {
+            return 1;
+        }
+    }
+
+    Record* data = new Record[records];
+    double start = now_secs();
+    for (long i = 0; i < records; ++i)
+    {
+        data[i].key = (unsigned int) i;
+        uthread_pipeline_enqueue(pipeline, 0, &data[i]);
+        if (rebalance && i == records / 2)
+        {
+            uthread_pipeline_set_threads(pipeline, 1, threads);
+        }
+    }
+    while (serialized < records)
+    {
+        uthread_sleep(MAIN_SLEEP_USECS);
+    }
+    double elapsed = now_secs() - start;
+
+    printf("batch %3d%s: %8.0f records/s\n", batch, rebalance ? " (enrich 1->n threads)" : "",
+           records / elapsed);
+    for (int stage = 0; stage < STAGES; ++stage)
+    {
+        uthread_pipeline_stage_stats_t stats;
+        uthread_pipeline_stats(pipeline, stage, &stats);
+        printf("  %-9s threads %u: avg batch %6.1f, latency avg %9.1fus max %9.1fus, "
+               "max queue %4u, producer parks %llu\n",
+               stageNames[stage], stats.threads, (double) stats.dequeued / stats.batches,
+               stats.total_latency_nsecs / 1e3 / stats.dequeued, stats.max_latency_nsecs / 1e3,
+               stats.max_queue_length, stats.producer_parks);
+    }
+    fflush(stdout);
+    uthread_pipeline_destroy(pipeline);
+    delete[] data;
+    uthread_terminate(0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    long records = argc > 1 ? atol(argv[1]) : 1000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 2;
+    int quantum = argc > 3 ? atoi(argv[3]) : 1000;
+    if (records <= 0 || threads <= 0 || threads * STAGES >= MAX_THREAD_NUM)
+    {
+        fprintf(stderr, "bench_pipeline: invalid record or thread count\n");
+        return 1;
+    }
+    int batches[] = {1, 8, 64, 256};
+    // the library can only be initialized once per process
+    for (int i = 0; i <= (int) (sizeof(batches) / sizeof(batches[0])); ++i)
+    {
+        bool rebalance = i == (int) (sizeof(batches) / sizeof(batches[0]));
+        pid_t child = fork();
+        if (child == 0)
+        {
+            exit(run(records, threads, rebalance ? 64 : batches[i], rebalance, quantum));
+        }
+        waitpid(child, nullptr, 0);
+    }
+    return 0;
+}
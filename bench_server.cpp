@@ -0,0 +1,397 @@
+/*
+ * Loopback request-per-thread server benchmark.
+ * A uthreads echo/RPC server runs one thread per connection; load generator kernel threads of the
+ * same process keep one request in flight per connection over socketpairs or loopback TCP, and
+ * report the request rate and the round-trip latency. A server thread parks while its socket is
+ * empty and the client that sends it a request wakes it with uthread_resume_remote.
+ * Usage: bench_server connections quantum_usecs work_iterations [seconds [socketpair|tcp]]
+ *        bench_server [seconds]   (a sweep over connections, quantum and work, one process per line)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define MSG_SIZE 64
+#define CLIENT_THREADS 2
+#define MAX_CONNECTIONS (MAX_THREAD_NUM - 1) /* the main thread takes one ID */
+#define CLIENT_POLL_MSECS 10
+#define MAIN_SLEEP_USECS 10000
+
+static int connections;
+static int work;
+static int serverFds[MAX_CONNECTIONS];
+static int clientFds[MAX_CONNECTIONS];
+static std::atomic<int> serverTids[MAX_CONNECTIONS];
+static std::atomic<int> nextConnection(0);
+static std::atomic<int> finished(0);
+static std::atomic<bool> stop(false);
+static volatile unsigned long long sink;
+
+struct Client
+{
+    pthread_t thread;
+    int first;
+    std::vector<long long> latencies;
+};
+
+static long long now_nsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Stands for the CPU a request costs the server.
+ */
+static void do_work(const char* request)
+{
+    unsigned long long x = (unsigned char) request[0];
+    for (int i = 0; i < work; ++i)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    sink += x;
+}
+
+static bool send_all(int fd, const char* buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno != EINTR && errno != EAGAIN)
+        {
+            return false;
+        }
+        if (n > 0)
+        {
+            buf += n;
+            len -= n;
+        }
+    }
+    return true;
+}
+
+static bool recv_all(int fd, char* buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n == 0 || (n < 0 && errno != EINTR))
+        {
+            return false;
+        }
+        if (n > 0)
+        {
+            buf += n;
+            len -= n;
+        }
+    }
+    return true;
+}
+
+/**
+ * One server thread per connection: read a request, work on it, answer, park while idle.
+ */
+static void serve()
+{
+    int connection = nextConnection.fetch_add(1);
+    int fd = serverFds[connection];
+    serverTids[connection] = uthread_get_tid();
+
+    char request[MSG_SIZE];
+    size_t got = 0;
+    for (;;)
+    {
+        ssize_t n = recv(fd, request + got, MSG_SIZE - got, 0);
+        if (n > 0)
+        {
+            got += n;
+            if (got == MSG_SIZE)
+            {
+                got = 0;
+                do_work(request);
+                if (!send_all(fd, request, MSG_SIZE))
+                {
+                    break;
+                }
+            }
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            uthread_park();
+        }
+        else if (errno != EINTR)
+        {
+            break;
+        }
+    }
+    close(fd);
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+static bool send_request(int connection, long long* sentAt)
+{
+    char request[MSG_SIZE] = {(char) connection};
+    *sentAt = now_nsecs();
+    if (!send_all(clientFds[connection], request, MSG_SIZE))
+    {
+        return false;
+    }
+    uthread_resume_remote(serverTids[connection]);
+    return true;
+}
+
+/**
+ * A closed-loop load generator over every CLIENT_THREADS-th connection from client->first.
+ */
+static void* run_client(void* arg)
+{
+    Client* client = (Client*) arg;
+    std::vector<int> mine;
+    for (int c = client->first; c < connections; c += CLIENT_THREADS)
+    {
+        mine.push_back(c);
+    }
+    for (int c : mine)
+    {
+        while (serverTids[c] < 0)
+        {
+            sched_yield();
+        }
+    }
+
+    std::vector<struct pollfd> fds(mine.size());
+    std::vector<long long> sentAt(mine.size());
+    for (size_t i = 0; i < mine.size(); ++i)
+    {
+        fds[i].fd = clientFds[mine[i]];
+        fds[i].events = POLLIN;
+        send_request(mine[i], &sentAt[i]);
+    }
+    while (!stop)
+    {
+        if (poll(fds.data(), fds.size(), CLIENT_POLL_MSECS) <= 0)
+        {
+            continue;
+        }
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            if (!(fds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            char response[MSG_SIZE];
+            if (!recv_all(fds[i].fd, response, MSG_SIZE))
+            {
+                return nullptr;
+            }
+            client->latencies.push_back(now_nsecs() - sentAt[i]);
+            if (!stop)
+            {
+                send_request(mine[i], &sentAt[i]);
+            }
+        }
+    }
+    for (int c : mine)
+    {
+        // the server thread finds the end of the stream once it is woken
+        close(clientFds[c]);
+        uthread_resume_remote(serverTids[c]);
+    }
+    return nullptr;
+}
+
+static bool make_socketpairs()
+{
+    for (int c = 0; c < connections; ++c)
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+        {
+            return false;
+        }
+        serverFds[c] = pair[0];
+        clientFds[c] = pair[1];
+    }
+    return true;
+}
+
+static bool make_tcp_connections()
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr*) &addr, sizeof(addr)) < 0 ||
+        listen(listener, MAX_CONNECTIONS) < 0 ||
+        getsockname(listener, (struct sockaddr*) &addr, &len) < 0)
+    {
+        return false;
+    }
+    int one = 1;
+    for (int c = 0; c < connections; ++c)
+    {
+        clientFds[c] = socket(AF_INET, SOCK_STREAM, 0);
+        if (clientFds[c] < 0 || connect(clientFds[c], (struct sockaddr*) &addr, sizeof(addr)) < 0)
+        {
+            return false;
+        }
+        serverFds[c] = accept(listener, nullptr, nullptr);
+        if (serverFds[c] < 0)
+        {
+            return false;
+        }
+        setsockopt(clientFds[c], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(serverFds[c], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    close(listener);
+    return true;
+}
+
+static int run(int quantum, double seconds, bool tcp)
+{
+    if (!(tcp ? make_tcp_connections() : make_socketpairs()))
+    {
+        perror("bench_server: setting up connections");
+        return 1;
+    }
+    for (int c = 0; c < connections; ++c)
+    {
+        fcntl(serverFds[c], F_SETFL, fcntl(serverFds[c], F_GETFL) | O_NONBLOCK);
+        serverTids[c] = -1;
+    }
+
+    // the clients must never take the preemption signal meant for the scheduler thread
+    sigset_t preemption, saved;
+    sigemptyset(&preemption);
+    sigaddset(&preemption, SIGVTALRM);
+    pthread_sigmask(SIG_BLOCK, &preemption, &saved);
+    Client clients[CLIENT_THREADS];
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        clients[i].first = i;
+        clients[i].latencies.reserve(1 << 20);
+        pthread_create(&clients[i].thread, nullptr, run_client, &clients[i]);
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+
+    // the scheduler thread's CPU clock, so the quantum is not eaten by the clients' time
+    if (uthread_init_with_timer(quantum, UTHREAD_TIMER_THREAD_CPU) != 0)
+    {
+        return 1;
+    }
+    for (int c = 0; c < connections; ++c)
+    {
+        if (uthread_spawn(serve) < 0)
+        {
+            return 1;
+        }
+    }
+
+    long long start = now_nsecs();
+    while (now_nsecs() - start < (long long) (seconds * 1e9))
+    {
+        uthread_sleep(MAIN_SLEEP_USECS);
+    }
+    stop = true;
+    long long elapsed = now_nsecs() - start;
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        pthread_join(clients[i].thread, nullptr);
+    }
+    while (finished < connections)
+    {
+        uthread_sleep(MAIN_SLEEP_USECS);
+    }
+
+    std::vector<long long> all;
+    for (int i = 0; i < CLIENT_THREADS; ++i)
+    {
+        all.insert(all.end(), clients[i].latencies.begin(), clients[i].latencies.end());
+    }
+    if (all.empty())
+    {
+        fprintf(stderr, "bench_server: no request completed\n");
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    printf("%-10s conns=%3d quantum=%5dus work=%6d: %9.0f req/s, latency p50 %8.1fus "
+           "p99 %8.1fus max %9.1fus\n",
+           tcp ? "tcp" : "socketpair", connections, quantum, work, all.size() / (elapsed / 1e9),
+           all[all.size() / 2] / 1e3, all[all.size() * 99 / 100] / 1e3, all.back() / 1e3);
+    fflush(stdout);
+    uthread_terminate(0);
+    return 0;
+}
+
+/**
+ * The library can only be initialized once per process, so every configuration gets a child.
+ */
+static void sweep(double seconds)
+{
+    const int connectionCounts[] = {1, 8, 32, MAX_CONNECTIONS};
+    const int quantums[] = {500, 5000};
+    const int works[] = {0, 20000};
+    for (int q : quantums)
+    {
+        for (int w : works)
+        {
+            for (int c : connectionCounts)
+            {
+                pid_t child = fork();
+                if (child == 0)
+                {
+                    connections = c;
+                    work = w;
+                    exit(run(q, seconds, false));
+                }
+                waitpid(child, nullptr, 0);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    signal(SIGPIPE, SIG_IGN);
+    if (argc < 4)
+    {
+        sweep(argc > 1 ? atof(argv[1]) : 1.0);
+        return 0;
+    }
+    connections = std::min(atoi(argv[1]), MAX_CONNECTIONS);
+    int quantum = atoi(argv[2]);
+    work = atoi(argv[3]);
+    double seconds = argc > 4 ? atof(argv[4]) : 2.0;
+    bool tcp = argc > 5 && strcmp(argv[5], "tcp") == 0;
+    if (connections <= 0)
+    {
+        fprintf(stderr, "bench_server: connections must be positive\n");
+        return 1;
+    }
+    return run(quantum, seconds, tcp);
+}
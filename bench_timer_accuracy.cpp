@@ -0,0 +1,95 @@
+/*
+ * Quantum accuracy benchmark.
+ * Runs two CPU-bound threads under the chosen preemption clock and reports how
+ * long each quantum actually lasted, measured on CLOCK_MONOTONIC.
+ * Usage: bench_timer_accuracy <virtual|monotonic|thread_cpu> <quantum_usecs> [quantums]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "uthreads.h"
+
+#define MAX_SAMPLES 100000
+#define NANO_SECONDS_IN_MICRO 1000.0
+
+static long long samples[MAX_SAMPLES];
+static volatile int sampleCount = 0;
+static int wantedSamples;
+
+static long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Records a timestamp every time the calling thread observes a new quantum. */
+static void spin()
+{
+    int lastQuantum = 0;
+    while (sampleCount < wantedSamples)
+    {
+        int quantum = uthread_get_total_quantums();
+        if (quantum != lastQuantum)
+        {
+            lastQuantum = quantum;
+            samples[sampleCount++] = now_ns();
+        }
+    }
+}
+
+static void worker()
+{
+    spin();
+    for (;;)
+    {
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <virtual|monotonic|thread_cpu> <quantum_usecs> [quantums]\n", argv[0]);
+        return 1;
+    }
+    int backend = UTHREAD_TIMER_VIRTUAL;
+    if (strcmp(argv[1], "monotonic") == 0)
+    {
+        backend = UTHREAD_TIMER_MONOTONIC;
+    }
+    else if (strcmp(argv[1], "thread_cpu") == 0)
+    {
+        backend = UTHREAD_TIMER_THREAD_CPU;
+    }
+    int quantum = atoi(argv[2]);
+    wantedSamples = std::min(argc > 3 ? atoi(argv[3]) : 2000, MAX_SAMPLES);
+
+    if (uthread_init_with_timer(quantum, backend) != 0)
+    {
+        return 1;
+    }
+    uthread_spawn(worker);
+    spin();
+
+    // the first interval includes the start-up, skip it
+    int n = sampleCount - 2;
+    long long* intervals = new long long[n];
+    double sum = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        intervals[i] = samples[i + 2] - samples[i + 1];
+        sum += intervals[i];
+    }
+    std::sort(intervals, intervals + n);
+    printf("%s quantum=%dus samples=%d mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n",
+           argv[1], quantum, n, sum / n / NANO_SECONDS_IN_MICRO,
+           intervals[n / 2] / NANO_SECONDS_IN_MICRO, intervals[n * 99 / 100] / NANO_SECONDS_IN_MICRO,
+           intervals[n - 1] / NANO_SECONDS_IN_MICRO);
+    delete[] intervals;
+    uthread_terminate(0);
+    return 0;
+}
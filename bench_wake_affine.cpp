@@ -0,0 +1,271 @@
+/*
+ * Producer/consumer benchmark for the run-next slot (uthread_set_run_next).
+ * Each pair hands a freshly written buffer back and forth with uthread_unpark/uthread_park, while
+ * background threads sweep their own large buffers and keep the ready queue full. The benchmark
+ * reports the items handed over per second, the handoff latency (unpark to the consumer
+ * running), the time the consumer takes to read the buffer it was handed, which grows when the
+ * buffer was evicted while the consumer waited in the queue, and, where perf events are
+ * available, the cache misses of that read. Every mode runs in its own process.
+ * Once the time is up the main thread stops every worker before it reads the statistics, since
+ * it can be preempted mid-read like any other thread.
+ * Usage: bench_wake_affine [seconds [pairs [background_threads]]]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define QUANTUM_USECS 2000
+#define PAIR_BYTES (32 * 1024) /* fits in L1/L2 while the pair stays on the CPU */
+#define BACKGROUND_BYTES (8 * 1024 * 1024) /* larger than the caches, evicts everything */
+#define MAX_PAIRS ((MAX_THREAD_NUM - 1) / 3)
+#define CACHE_LINE 64
+#define MAIN_SLEEP_USECS 10000
+
+struct Pair
+{
+    int producer;
+    int consumer;
+    long long handedAt;
+    bool full;
+    char buffer[PAIR_BYTES];
+};
+
+static int pairCount;
+static int backgroundCount;
+static Pair* pairs;
+static volatile unsigned long long sink;
+static std::vector<long long> latencies;
+static std::vector<long long> readTimes;
+static int perfFd = -1;
+static long long backgroundBytes;
+static volatile bool stopping;
+static int stoppedWorkers;
+
+static long long now_nsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Parks the calling worker for good once the main thread asked the workers to stop.
+ */
+static void stop_worker()
+{
+    __atomic_add_fetch(&stoppedWorkers, 1, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        uthread_park();
+    }
+}
+
+static Pair* my_pair(bool producer)
+{
+    int tid = uthread_get_tid();
+    for (int i = 0; i < pairCount; ++i)
+    {
+        if ((producer ? pairs[i].producer : pairs[i].consumer) == tid)
+        {
+            return &pairs[i];
+        }
+    }
+    return nullptr;
+}
+
+static void produce()
+{
+    Pair* pair = my_pair(true);
+    unsigned char value = 0;
+    for (;;)
+    {
+        while (pair->full && !stopping)
+        {
+            uthread_park();
+        }
+        if (stopping)
+        {
+            stop_worker();
+        }
+        memset(pair->buffer, value++, PAIR_BYTES);
+        pair->full = true;
+        pair->handedAt = now_nsecs();
+        uthread_unpark(pair->consumer);
+    }
+}
+
+static void consume()
+{
+    Pair* pair = my_pair(false);
+    for (;;)
+    {
+        while (!pair->full && !stopping)
+        {
+            uthread_park();
+        }
+        if (stopping)
+        {
+            stop_worker();
+        }
+        long long start = now_nsecs();
+        latencies.push_back(start - pair->handedAt);
+        if (perfFd >= 0)
+        {
+            ioctl(perfFd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        unsigned long long sum = 0;
+        for (int i = 0; i < PAIR_BYTES; i += CACHE_LINE)
+        {
+            sum += (unsigned char) pair->buffer[i];
+        }
+        if (perfFd >= 0)
+        {
+            ioctl(perfFd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        readTimes.push_back(now_nsecs() - start);
+        sink += sum;
+        pair->full = false;
+        uthread_unpark(pair->producer);
+    }
+}
+
+/**
+ * Keeps the ready queue busy and the caches cold.
+ */
+static void sweep()
+{
+    char* memory = (char*) malloc(BACKGROUND_BYTES);
+    memset(memory, 1, BACKGROUND_BYTES);
+    while (!stopping)
+    {
+        for (int i = 0; i < BACKGROUND_BYTES; i += CACHE_LINE)
+        {
+            memory[i]++;
+        }
+        backgroundBytes += BACKGROUND_BYTES;
+    }
+    stop_worker();
+}
+
+/**
+ * Counts the cache misses of the consumers' reads, which enable it around each read.
+ * @return -1 where perf events are not available.
+ */
+static int open_cache_miss_counter()
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static long long percentile(std::vector<long long>& values, int percent)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() * percent / 100];
+}
+
+static int run(bool runNext, double seconds)
+{
+    pairs = new Pair[pairCount]();
+    latencies.reserve(1 << 22);
+    readTimes.reserve(1 << 22);
+    perfFd = open_cache_miss_counter();
+
+    if (uthread_init(QUANTUM_USECS) != 0 || uthread_set_run_next(runNext) != 0)
+    {
+        return 1;
+    }
+    for (int i = 0; i < pairCount; ++i)
+    {
+        pairs[i].consumer = uthread_spawn(consume);
+        pairs[i].producer = uthread_spawn(produce);
+    }
+    for (int i = 0; i < backgroundCount; ++i)
+    {
+        uthread_spawn(sweep);
+    }
+
+    long long start = now_nsecs();
+    while (now_nsecs() - start < (long long) (seconds * 1e9))
+    {
+        uthread_sleep(MAIN_SLEEP_USECS);
+    }
+    double elapsed = (now_nsecs() - start) / 1e9;
+
+    // a consumer preempted main mid-sort would append to the vectors being sorted, so every
+    // worker is parked for good first; the unparks wake the ones parked for their partner
+    stopping = true;
+    while (__atomic_load_n(&stoppedWorkers, __ATOMIC_RELAXED) < 2 * pairCount + backgroundCount)
+    {
+        for (int i = 0; i < pairCount; ++i)
+        {
+            uthread_unpark(pairs[i].producer);
+            uthread_unpark(pairs[i].consumer);
+        }
+        uthread_sleep(MAIN_SLEEP_USECS);
+    }
+
+    long long misses = -1;
+    if (perfFd >= 0 && read(perfFd, &misses, sizeof(misses)) != sizeof(misses))
+    {
+        misses = -1;
+    }
+    size_t items = latencies.size();
+    char missText[32] = "n/a";
+    if (misses >= 0 && items > 0)
+    {
+        snprintf(missText, sizeof(missText), "%.1f", (double) misses / items);
+    }
+    printf("run-next %-3s pairs=%2d background=%2d: %9.0f items/s, handoff p50 %8.1fus "
+           "p99 %8.1fus, read p50 %6.2fus p99 %6.2fus, misses/read %s, background %.0f MB/s\n",
+           runNext ? "on" : "off", pairCount, backgroundCount, items / elapsed,
+           percentile(latencies, 50) / 1e3, percentile(latencies, 99) / 1e3,
+           percentile(readTimes, 50) / 1e3, percentile(readTimes, 99) / 1e3, missText,
+           backgroundBytes / elapsed / (1024 * 1024));
+    fflush(stdout);
+    uthread_terminate(0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    pairCount = std::min(argc > 2 ? atoi(argv[2]) : 4, MAX_PAIRS);
+    backgroundCount = std::min(argc > 3 ? atoi(argv[3]) : 4, MAX_THREAD_NUM - 1 - 2 * pairCount);
+    if (pairCount <= 0 || backgroundCount < 0)
+    {
+        fprintf(stderr, "bench_wake_affine: pairs must be positive and background non-negative\n");
+        return 1;
+    }
+    // the library can only be initialized once per process
+    for (int runNext = 0; runNext <= 1; ++runNext)
+    {
+        pid_t child = fork();
+        if (child == 0)
+        {
+            exit(run(runNext, seconds));
+        }
+        waitpid(child, nullptr, 0);
+    }
+    return 0;
+}
@@ -1,376 +1,3035 @@
-#include <iostream>
-#include <stdlib.h>
-#include "sync_handler.h"
-
-
-/**
- * set the masking set and check system calls
- * @return
- */
-void sync_handler::init_maskedSignals()
-{
-    if (sigemptyset(&_maskedSignals) < SUCCESS)
-    {
-        exit_and_print_error(SIGEMPTYSET_FAIL_MSG);
-    }
-    if (sigaddset(&_maskedSignals, SIGVTALRM) < SUCCESS)
-    {
-        exit_and_print_error(SIGADDSET_FAIL_MSG);
-    }
-}
-
-void sync_handler::block_maskedSignals()
-{
-    if (sigprocmask(SIG_BLOCK, &_maskedSignals, NULL) < SUCCESS)
-    {
-        exit_and_print_error(SIGPROCMASK_BLOCK_FAIL_MSG);
-    }
-}
-
-void sync_handler::unblock_maskedSignals()
-{
-    if (sigprocmask(SIG_UNBLOCK, &_maskedSignals, NULL) < SUCCESS)
-    {
-        exit_and_print_error(SIGPROCMASK_UNBLOCK_FAIL_MSG);
-    }
-}
-
-void sync_handler::exit_and_print_error(std::string msg)
-{
-    fprintf(stderr, "%s%s/n", SYSTEM_ERROR, msg.c_str());
-    release_resources_by_thread(_runningThread->getId());
-    release_all_resources();
-    exit(FAIL);
-    // TODO finish NETTA
-}
-
-int sync_handler::return_and_print_error(std::string msg)
-{
-    fprintf(stderr, "%s%s/n", THREAD_LIBRARY_ERROR, msg.c_str());
-    release_resources_by_thread(_runningThread->getId());
-    release_all_resources();
-    return FAIL;
-    // TODO finish NETTA
-}
-
-Thread* sync_handler::create_main_thread()
-{
-    Thread* thread = new(std::nothrow) Thread(0, nullptr);
-    if (thread == nullptr)
-    {
-        exit_and_print_error(CREATE_THREAD_FAIL_MSG);
-    }
-    thread->setState(RUNNING);
-    thread->increaseQuantumCount();
-    _allThreads[0] = thread;
-    return thread;
-}
-
-int sync_handler::create_new_thread(void (*f)(void))
-{
-    int id = _nextAvailableID.top();
-    Thread* thread = new(std::nothrow) Thread(id, f);
-    if (thread == nullptr)
-    {
-        exit_and_print_error(CREATE_THREAD_FAIL_MSG);
-    }
-    _nextAvailableID.pop();
-    thread->setState(READY);
-    _readyThreads.push_back(id);
-    _allThreads[id] = thread;
-    return id;
-}
-
-/**
- * @brief
- */
-void sync_handler::init_sync_handler(int quantum_usecs)
-{
-    init_maskedSignals();
-
-    for (int i = 1; i < MAX_THREAD_NUM; ++i)
-    {
-        _nextAvailableID.push(i);
-    }
-
-    _quantumSecs = quantum_usecs;
-    _totalQuantumCount = 1;
-    _runningThread = create_main_thread();
-
-    init_mutex();
-    init_timer();
-    set_timer();
-}
-
-void sync_handler::sigvtalrm_handler(int)
-{
-    block_maskedSignals();
-    changeStateToReady(_runningThread->getId());
-
-    int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
-    if (ret_val == 0)
-    {
-        changeStateToRunning();
-    }
-    // TODO check if need to clear resources
-    unblock_maskedSignals();
-}
-
-void sync_handler::changeStateToReady(int id)
-{
-    Thread* threadToReady = _allThreads[id];
-    threadToReady->setState(READY);
-    _readyThreads.push_back(threadToReady->getId());
-    //TODO: WE NEED TO CALL THE NEXT THREAD IN THE Q TO RUN ?
-}
-
-void sync_handler::changeStateToRunning() // TODO CHANGE THIS METHOD NAME
-{
-    _totalQuantumCount++;
-    //TODO: THINK IF WE NEED TO CHECK FIRST THAT THE _readyThreads is not empty
-    _runningThread = _allThreads[_readyThreads.front()];
-    _runningThread->setState(RUNNING);
-    _runningThread->increaseQuantumCount();
-    _readyThreads.pop_front();
-
-    set_timer();
-    siglongjmp(_runningThread->getEnv(), RETURN_VALUE_FROM_JMP);
-}
-
-void sync_handler::changeStateToBlocked(int id)
-{
-    block_maskedSignals();
-    Thread* threadToBlock = _allThreads[id];
-
-    if (threadToBlock->getState() == RUNNING)
-    {
-        reset_timer();
-        //If a thread blocks itself, a scheduling decision should be made ?
-        int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
-        if (ret_val == 0)
-        {
-            //preempt the next ready thread to RUNNING
-            changeStateToRunning();
-        }
-    }
-    //TODO: DO WE NEED TO CHECK IF THERE ARE RESOURCES TO DELETE?
-
-    if (threadToBlock->getState() == READY)
-    {
-        //remove thread from the ready queue
-        remove_from_readyThreads(threadToBlock);
-    }
-
-    int newState = (threadToBlock->getState() == BLOCKED_MUTEX) ? BLOCKED_AND_BLOCKED_MUTEX :
-            BLOCKED;
-
-    //change the state and add to the blocked thread map
-    threadToBlock->setState(newState);
-    _blockedThreads[id] = threadToBlock;
-
-    unblock_maskedSignals();
-}
-
-void sync_handler::resumeThread(int id)
-{
-    block_maskedSignals();
-    //remove from the blocked list
-    _blockedThreads.erase(id);
-    if (_allThreads[id]->getState() == BLOCKED_AND_BLOCKED_MUTEX)
-    {
-        _allThreads[id]->setState(BLOCKED_MUTEX);
-    }
-    else
-    {
-        changeStateToReady(id);
-    }
-    unblock_maskedSignals();
-}
-
-void sync_handler::init_timer()
-{
-    _sa.sa_handler = &sigvtalrm_handler;
-
-    if (sigaction(SIGVTALRM, &_sa, NULL) < 0)
-    {
-        exit_and_print_error(SIGACTION_ERR_MSG);
-    }
-}
-
-void sync_handler::init_mutex()
-{
-    _mutex = PTHREAD_MUTEX_INITIALIZER;
-    _mutexThreadId = UNLOCKED;
-    if (pthread_mutex_init(&_mutex, nullptr) != SUCCESS)
-    {
-        // TODO check if we want to terminate.
-        exit_and_print_error(INIT_MUTEX_ERR);
-    }
-}
-
-void sync_handler::set_interval_timer()
-{
-    if (setitimer (ITIMER_VIRTUAL, &_timer, NULL)) {
-        exit_and_print_error(SETITIMER_ERR_MSG);
-    }
-}
-
-void sync_handler::set_timer()
-{
-    _timer.it_value.tv_sec = _quantumSecs / MICRO_SECONDS;
-    _timer.it_value.tv_usec = _quantumSecs % MICRO_SECONDS;
-
-    _timer.it_interval.tv_sec = RESET_TIMER;
-    _timer.it_interval.tv_usec = RESET_TIMER;
-
-    set_interval_timer();
-}
-
-void sync_handler::reset_timer()
-{
-    _timer.it_value.tv_sec = RESET_TIMER;
-    _timer.it_value.tv_usec = RESET_TIMER;
-
-    _timer.it_interval.tv_sec = RESET_TIMER;
-    _timer.it_interval.tv_usec = RESET_TIMER;
-
-    set_interval_timer();
-}
-
-bool sync_handler::can_add_new_thread()
-{
-    return (_allThreads.size() < MAX_THREAD_NUM);
-}
-
-Thread* sync_handler::get_thread_by_id(int id)
-{
-    auto thread = _allThreads.find(id);
-    if(thread == _allThreads.end())
-    {
-        return nullptr;
-    }
-    return thread->second;
-}
-
-void sync_handler::release_resources_by_thread(int id)
-{
-    block_maskedSignals();
-    Thread* threadToTerminate = _allThreads[id];
-    if (threadToTerminate->getState() == BLOCKED ||
-    threadToTerminate->getState() == BLOCKED_AND_BLOCKED_MUTEX)
-    {
-        _blockedThreads.erase(id);
-    }
-    if (threadToTerminate->getState() == READY)
-    {
-        remove_from_readyThreads(threadToTerminate);
-    }
-    if (threadToTerminate->getState() == BLOCKED_MUTEX ||
-    threadToTerminate->getState() == BLOCKED_AND_BLOCKED_MUTEX)
-    {
-        unlock_mutex();
-    }
-    delete(threadToTerminate);
-    _allThreads.erase(id);
-    _nextAvailableID.push(id);
-    unblock_maskedSignals();
-}
-
-void sync_handler::remove_from_readyThreads(Thread* threadToRemove)
-{
-    int i = 0;
-    for(auto threadId : _readyThreads)
-    {
-        if (threadToRemove->getId() == threadId)
-        {
-            _readyThreads.erase(_readyThreads.begin() + i);
-        }
-        i++;
-    }
-}
-
-void sync_handler::release_all_resources()
-{
-    block_maskedSignals();
-    for (auto th : _allThreads)
-    {
-        delete(th.second);
-    }
-    _readyThreads.clear();
-    _blockedThreads.clear();
-    // todo check if need to delete priority queue
-    unblock_maskedSignals();
-}
-
-int sync_handler::get_running_thread_id()
-{
-    return _runningThread->getId();
-}
-
-int sync_handler::get_mutex_thread_id()
-{
-    return _mutexThreadId;
-}
-
-int sync_handler::get_total_quantums()
-{
-    return _totalQuantumCount;
-}
-
-int sync_handler::get_quantums_by_id(int id)
-{
-    return _allThreads[id]->getQuantumCount();
-}
-
-int sync_handler::lock_mutex()
-{
-    // sigset will save the current location to return to in case the lock fails.
-    sigsetjmp(_runningThread->getEnv(), 1);
-    block_maskedSignals();
-    if (_mutexThreadId != -1)
-    {
-        _runningThread->setState(BLOCKED_MUTEX);
-        _mutexBlockedThreads.push_back(_runningThread->getId());
-        changeStateToRunning(); // puts a new thread in running
-        unblock_maskedSignals();
-        return -1; // TODO CEHCK THIS - what should we return?
-    }
-
-    if (pthread_mutex_lock(&_mutex) != SUCCESS)
-    {
-        exit_and_print_error(LOCK_FAIL_MSG);
-    }
-    _mutexThreadId = get_running_thread_id();
-    unblock_maskedSignals();
-    return SUCCESS;
-}
-
-int sync_handler::unlock_mutex()
-{
-    block_maskedSignals();
-    if (pthread_mutex_unlock(&_mutex) != SUCCESS){
-        exit_and_print_error(UNLOCK_FAIL_MSG);
-    }
-    _mutexThreadId = -1;
-
-    // Searching for the first thread that isn't BLOCKED, and changing its state to READY.
-    int i = 0;
-    for(auto threadId : _mutexBlockedThreads)
-    {
-        Thread* nextThread = _allThreads[threadId];
-        if (nextThread->getState() == BLOCKED_MUTEX)
-        {
-            _mutexBlockedThreads.erase(_mutexBlockedThreads.begin() + i);
-            changeStateToReady(nextThread->getId());
-            unblock_maskedSignals();
-            return SUCCESS;
-        }
-        i++;
-    }
-    // When reaching this part, all threads are BLOCKED_AND_BLOCKED_MUTEX
-    // We will take the first thread and change it's state to blocked (removing the mutex block).
-    Thread* nextThread = _allThreads[_mutexBlockedThreads.front()];
-    _mutexBlockedThreads.pop_front();
-    nextThread->setState(BLOCKED);
-    return SUCCESS;
-}
\ No newline at end of file
+#include <algorithm>
+#include <new>
+#include <limits.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include "sync_handler.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+int sync_handler::_totalQuantumCount;
+Thread* sync_handler::_runningThread;
+int sync_handler::_mutexThreadId;
+SchedPolicy sync_handler::_readyThreads;
+std::set<std::pair<unsigned long long, int>> sync_handler::_fairReadyThreads;
+int sync_handler::_schedPolicy;
+unsigned long long sync_handler::_minVruntime;
+std::set<std::pair<long long, int>> sync_handler::_deadlineReadyThreads;
+std::set<int> sync_handler::_deadlineThreads;
+long long sync_handler::_deadlineUtilization;
+std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> sync_handler::_nextAvailableKey;
+void (*sync_handler::_keyDestructors[UTHREAD_KEYS_MAX])(void*);
+bool sync_handler::_keyInUse[UTHREAD_KEYS_MAX];
+std::set<std::pair<long long, int>> sync_handler::_sleepingThreads;
+std::set<std::pair<long long, int>> sync_handler::_throttledThreads;
+int sync_handler::_quotaThreadCount;
+ThreadGroup* sync_handler::_groups[UTHREAD_GROUPS_MAX];
+std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> sync_handler::_nextAvailableGroup;
+int sync_handler::_groupCount;
+Thread* sync_handler::_zombieThread;
+Thread* sync_handler::_handoffThread;
+bool sync_handler::_donatingSlice;
+std::vector<RcuCallback> sync_handler::_rcuNext;
+std::vector<RcuCallback> sync_handler::_rcuCurrent;
+std::vector<RcuCallback> sync_handler::_rcuDone;
+bool sync_handler::_rcuGracePeriod;
+bool sync_handler::_rcuWaiting[MAX_THREAD_NUM];
+int sync_handler::_rcuWaitingCount;
+long long sync_handler::_rcuStarted;
+long long sync_handler::_rcuCompleted;
+bool sync_handler::_rcuNextRequested;
+std::vector<std::pair<long long, int>> sync_handler::_rcuSynchronizers;
+bool sync_handler::_runNextEnabled;
+Thread* sync_handler::_runNextThread;
+long long sync_handler::_runNextStreakStartUsecs;
+bool sync_handler::_stackProfiling;
+std::map<ThreadEntry, std::pair<size_t, int>> sync_handler::_entryStackPeaks;
+std::unordered_map<int, Thread*> sync_handler::_allThreads;
+std::unordered_map<int, Thread*> sync_handler::_blockedThreads;
+std::deque<int> sync_handler::_mutexBlockedThreads;
+sigset_t sync_handler::_maskedSignals;
+std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> sync_handler::_nextAvailableID;
+struct sigaction sync_handler::_sa;
+struct itimerval sync_handler::_timer;
+int sync_handler::_timerBackend;
+timer_t sync_handler::_posixTimer;
+bool sync_handler::_adaptiveQuantum;
+int sync_handler::_minQuantumUsecs;
+int sync_handler::_maxQuantumUsecs;
+int sync_handler::_latencySensitiveReady;
+long long sync_handler::_sliceStartUsecs;
+bool sync_handler::_idle;
+std::atomic<unsigned long long> sync_handler::_remoteWakeups[REMOTE_WAKEUP_WORDS];
+int sync_handler::_wakeupFd = FAIL;
+std::atomic<bool> sync_handler::_wakeupKicked;
+int sync_handler::_quantumSecs;
+pthread_mutex_t sync_handler::_mutex;
+
+bool sync_handler::_profiling;
+bool sync_handler::_lockProfiling;
+Arena* sync_handler::_sharedArena = nullptr;
+int sync_handler::_profileSampleUsecs;
+timer_t sync_handler::_profileTimer;
+bool sync_handler::_profileTimerCreated;
+long long sync_handler::_simNowUsecs;
+long long sync_handler::_simSliceEndUsecs;
+unsigned int sync_handler::_simSeed;
+unsigned long long sync_handler::_simRandom;
+int sync_handler::_simJitterPercent;
+bool sync_handler::_simPreempting;
+int sync_handler::_simRecordFd = FAIL;
+std::vector<SimDecision> sync_handler::_simReplay;
+size_t sync_handler::_simReplayNext;
+bool sync_handler::_simReplayDiverged;
+uthread_metrics* sync_handler::_metrics;
+std::string sync_handler::_metricsName;
+
+static_assert(UTHREAD_METRICS_RUNNING == RUNNING && UTHREAD_METRICS_READY == READY &&
+              UTHREAD_METRICS_BLOCKED == BLOCKED && UTHREAD_METRICS_BLOCKED_MUTEX == BLOCKED_MUTEX &&
+              UTHREAD_METRICS_BLOCKED_AND_BLOCKED_MUTEX == BLOCKED_AND_BLOCKED_MUTEX &&
+              UTHREAD_METRICS_WAITING_PERIOD == WAITING_PERIOD &&
+              UTHREAD_METRICS_THROTTLED == THROTTLED,
+              "the published thread states are Thread's");
+
+/**
+ * CLOCK_MONOTONIC in micro-seconds, or the virtual clock under UTHREAD_TIMER_SIMULATED.
+ */
+long long sync_handler::now_usecs()
+{
+    if (_timerBackend == UTHREAD_TIMER_SIMULATED)
+    {
+        return _simNowUsecs;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * (long long) MICRO_SECONDS + now.tv_nsec / NANO_SECONDS_IN_MICRO;
+}
+
+/**
+ * set the masking set and check system calls
+ * @return
+ */
+void sync_handler::init_maskedSignals()
+{
+    if (sigemptyset(&_maskedSignals) < SUCCESS)
+    {
+        exit_and_print_error(SIGEMPTYSET_FAIL_MSG);
+    }
+    // a profiling sample taken in the middle of a switch could see a half-updated scheduler
+    if (sigaddset(&_maskedSignals, SIGVTALRM) < SUCCESS ||
+        sigaddset(&_maskedSignals, SIGPROF) < SUCCESS)
+    {
+        exit_and_print_error(SIGADDSET_FAIL_MSG);
+    }
+}
+
+void sync_handler::block_maskedSignals()
+{
+    if (sigprocmask(SIG_BLOCK, &_maskedSignals, NULL) < SUCCESS)
+    {
+        exit_and_print_error(SIGPROCMASK_BLOCK_FAIL_MSG);
+    }
+}
+
+void sync_handler::unblock_maskedSignals()
+{
+    if (sigprocmask(SIG_UNBLOCK, &_maskedSignals, NULL) < SUCCESS)
+    {
+        exit_and_print_error(SIGPROCMASK_UNBLOCK_FAIL_MSG);
+    }
+}
+
+void sync_handler::exit_and_print_error(std::string msg)
+{
+    fprintf(stderr, "%s%s\n", SYSTEM_ERROR, msg.c_str());
+    release_resources_by_thread(_runningThread->getId());
+    release_all_resources();
+    exit(FAIL);
+    // TODO finish NETTA
+}
+
+int sync_handler::return_and_print_error(std::string msg)
+{
+    // a library error only fails the call, the caller's thread and the others go on
+    fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, msg.c_str());
+    return FAIL;
+}
+
+Thread* sync_handler::create_main_thread()
+{
+    Thread* thread = new(std::nothrow) Thread(0, nullptr);
+    if (thread == nullptr)
+    {
+        exit_and_print_error(CREATE_THREAD_FAIL_MSG);
+    }
+    set_state(thread, RUNNING);
+    thread->increaseQuantumCount();
+    thread->setQuantumUsecs(_quantumSecs);
+    _allThreads[0] = thread;
+    return thread;
+}
+
+/**
+ * @param group the group the thread joins, NO_GROUP for none.
+ */
+int sync_handler::create_new_thread(void (*f)(void), int group)
+{
+    // the scheduler allocates when it queues a thread, so a preemption must not land inside new
+    block_maskedSignals();
+    int id = _nextAvailableID.top();
+    Thread* thread = new(std::nothrow) Thread(id, f);
+    if (thread == nullptr)
+    {
+        exit_and_print_error(CREATE_THREAD_FAIL_MSG);
+    }
+    _nextAvailableID.pop();
+    set_state(thread, READY);
+    thread->setQuantumUsecs(_quantumSecs);
+    profile_new_stack(thread);
+    if (group != NO_GROUP)
+    {
+        _groups[group]->addMember(thread);
+    }
+    push_to_readyThreads(thread);
+    _allThreads[id] = thread;
+    unblock_maskedSignals();
+    return id;
+}
+
+/**
+ * Spawns count threads in one critical section and queues them with a single splice. The caller
+ * checked that there are count free IDs.
+ */
+int sync_handler::create_many_threads(void (*const fns[])(void), int count, int tids[])
+{
+    Thread* threads[MAX_THREAD_NUM];
+    block_maskedSignals();
+    for (int i = 0; i < count; ++i)
+    {
+        int id = _nextAvailableID.top();
+        Thread* thread = new(std::nothrow) Thread(id, fns[i]);
+        if (thread == nullptr)
+        {
+            exit_and_print_error(CREATE_THREAD_FAIL_MSG);
+        }
+        _nextAvailableID.pop();
+        set_state(thread, READY);
+        thread->setQuantumUsecs(_quantumSecs);
+        profile_new_stack(thread);
+        _allThreads[id] = thread;
+        threads[i] = thread;
+        tids[i] = id;
+    }
+    push_many_to_readyThreads(threads, count);
+    unblock_maskedSignals();
+    return SUCCESS;
+}
+
+/**
+ * @brief
+ */
+void sync_handler::init_sync_handler(int quantum_usecs, int timer_backend)
+{
+    init_maskedSignals();
+
+    for (int i = 1; i < MAX_THREAD_NUM; ++i)
+    {
+        _nextAvailableID.push(i);
+    }
+    for (int key = 0; key < UTHREAD_KEYS_MAX; ++key)
+    {
+        _nextAvailableKey.push(key);
+    }
+    for (int group = 0; group < UTHREAD_GROUPS_MAX; ++group)
+    {
+        _nextAvailableGroup.push(group);
+    }
+
+    _quantumSecs = quantum_usecs;
+    _timerBackend = timer_backend;
+    _simNowUsecs = SIM_EPOCH_USECS;
+    _totalQuantumCount = 1;
+    _runningThread = create_main_thread();
+
+    _wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeupFd < SUCCESS)
+    {
+        exit_and_print_error(EVENTFD_ERR_MSG);
+    }
+
+    init_mutex();
+    init_timer();
+    set_timer();
+}
+
+void sync_handler::sigvtalrm_handler(int, siginfo_t*, void* context)
+{
+    if (_idle)
+    {
+        // a tick that was already pending when the timer got disarmed, nothing runs to preempt
+        return;
+    }
+    block_maskedSignals();
+    if (_profiling && _profileSampleUsecs == 0)
+    {
+        Profiler::record(_runningThread, context);
+    }
+    preempt_running_thread();
+    // no unblock here: returning from the handler restores the interrupted thread's mask, while
+    // unblocking first would let the next tick nest another signal frame on this small stack
+}
+
+/**
+ * Takes a profiling sample of the running thread. SIGVTALRM is blocked while this runs, so the
+ * thread cannot be switched away in the middle of it.
+ */
+void sync_handler::sigprof_handler(int, siginfo_t*, void* context)
+{
+    if (_profiling && !_idle)
+    {
+        Profiler::record(_runningThread, context);
+    }
+}
+
+/**
+ * Moves the running thread to the ready queue and switches to the next thread. Returns when the
+ * preempted thread is scheduled again. The caller must have the signals blocked.
+ */
+void sync_handler::preempt_running_thread()
+{
+    end_slice(true);
+    // threads due now go ahead of the preempted one
+    release_woken_threads();
+    set_state(_runningThread, READY);
+    push_preempted_to_readyThreads(_runningThread);
+
+    int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
+    if (ret_val == 0)
+    {
+        changeStateToRunning();
+    }
+}
+
+/**
+ * Gives the CPU to a thread that has just become READY if it is a deadline job that should run
+ * before the current thread. The caller must have the signals blocked.
+ */
+void sync_handler::preempt_for_deadline(Thread* woken)
+{
+    if (_idle || !woken->hasBudget() || woken == _runningThread)
+    {
+        return;
+    }
+    if (!_runningThread->hasBudget() ||
+        woken->getDeadlineUsecs() < _runningThread->getDeadlineUsecs())
+    {
+        preempt_running_thread();
+    }
+}
+
+void sync_handler::changeStateToReady(int id)
+{
+    Thread* threadToReady = _allThreads[id];
+    set_state(threadToReady, READY);
+    push_to_readyThreads(threadToReady);
+    //TODO: WE NEED TO CALL THE NEXT THREAD IN THE Q TO RUN ?
+}
+
+/**
+ * Makes READY a thread the running thread woke. With the run-next slot on, a best-effort thread
+ * takes the slot, so it runs right after its waker while the data they share is still in the
+ * cache; the thread it displaces goes to the back of the queue, as with Go's runnext.
+ */
+void sync_handler::wake_thread(int id)
+{
+    Thread* thread = _allThreads[id];
+    if (!_runNextEnabled || thread->hasBudget())
+    {
+        changeStateToReady(id);
+        return;
+    }
+    set_state(thread, READY);
+    if (throttle_if_over_quota(thread))
+    {
+        return;
+    }
+    flush_run_next();
+    _runNextThread = thread;
+    if (thread->isLatencySensitive())
+    {
+        _latencySensitiveReady++;
+    }
+}
+
+/**
+ * Whether the next pick may take the slot: a pair of threads waking each other shares one
+ * quantum of slot picks, after which the queue gets its turn. The caller checked that the slot
+ * is full.
+ */
+bool sync_handler::can_run_next()
+{
+    if (_schedPolicy != UTHREAD_SCHED_FAIR && _readyThreads.outranks(_runNextThread))
+    {
+        return false;
+    }
+    return _runNextStreakStartUsecs == 0 || now_usecs() - _runNextStreakStartUsecs < _quantumSecs;
+}
+
+/**
+ * Moves the thread in the slot, if any, to the back of the queue.
+ */
+void sync_handler::flush_run_next()
+{
+    Thread* thread = _runNextThread;
+    if (thread == nullptr)
+    {
+        return;
+    }
+    _runNextThread = nullptr;
+    if (thread->isLatencySensitive())
+    {
+        _latencySensitiveReady--;
+    }
+    push_to_readyThreads(thread);
+}
+
+void sync_handler::changeStateToRunning() // TODO CHANGE THIS METHOD NAME
+{
+    if (_rcuWaitingCount > 0)
+    {
+        rcu_quiescent(_runningThread);
+    }
+    _totalQuantumCount++;
+    reap_zombie_thread();
+    release_woken_threads();
+    if (_handoffThread != nullptr)
+    {
+        _runningThread = _handoffThread;
+        _handoffThread = nullptr;
+    }
+    else
+    {
+        if (!has_ready_threads())
+        {
+            idle_until_ready();
+        }
+        _runningThread = is_simulated() ? sim_pick_next_thread() : pop_from_readyThreads();
+    }
+    _runningThread->setState(RUNNING);
+    _runningThread->increaseQuantumCount();
+    if (_runningThread->getGroup() != NO_GROUP)
+    {
+        _groups[_runningThread->getGroup()]->increaseQuantumCount();
+    }
+    _runningThread->setQuantumUsecs(choose_quantum(_runningThread));
+    if (_metrics != nullptr)
+    {
+        publish_metrics(_runningThread);
+    }
+
+    if (_donatingSlice)
+    {
+        // the timer armed for the thread that handed off keeps running for the target
+        _donatingSlice = false;
+    }
+    else
+    {
+        set_timer();
+    }
+    siglongjmp(_runningThread->getEnv(), RETURN_VALUE_FROM_JMP);
+}
+
+void sync_handler::changeStateToBlocked(int id)
+{
+    block_maskedSignals();
+    Thread* threadToBlock = _allThreads[id];
+    bool blocksItself = (threadToBlock->getState() == RUNNING);
+    //TODO: DO WE NEED TO CHECK IF THERE ARE RESOURCES TO DELETE?
+
+    if (threadToBlock->getState() == READY)
+    {
+        //remove thread from the ready queue
+        remove_from_readyThreads(threadToBlock);
+    }
+    else if (threadToBlock->getState() == THROTTLED)
+    {
+        unthrottle(threadToBlock);
+    }
+
+    int newState = (threadToBlock->getState() == BLOCKED_MUTEX) ? BLOCKED_AND_BLOCKED_MUTEX :
+            BLOCKED;
+
+    // change the state and add to the blocked thread map before switching away, so the thread is
+    // already BLOCKED while others run
+    set_state(threadToBlock, newState);
+    _blockedThreads[id] = threadToBlock;
+
+    if (blocksItself)
+    {
+        reset_timer();
+        end_slice(false);
+        //If a thread blocks itself, a scheduling decision should be made
+        int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
+        if (ret_val == 0)
+        {
+            //preempt the next ready thread to RUNNING
+            changeStateToRunning();
+        }
+    }
+
+    unblock_maskedSignals();
+}
+
+void sync_handler::resumeThread(int id)
+{
+    block_maskedSignals();
+    //remove from the blocked list
+    _blockedThreads.erase(id);
+    if (_allThreads[id]->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        set_state(_allThreads[id], BLOCKED_MUTEX);
+    }
+    else
+    {
+        wake_thread(id);
+        preempt_for_deadline(_allThreads[id]);
+    }
+    unblock_maskedSignals();
+}
+
+/**
+ * Queues the running thread as READY and switches to target, which must be READY, without going
+ * through the ready queues. A deadline target always gets a timer bounded by its own budget. The
+ * caller must have the signals blocked.
+ */
+void sync_handler::switch_to(Thread* target, bool donateSlice)
+{
+    remove_from_readyThreads(target);
+    _handoffThread = target;
+    _donatingSlice = donateSlice && !target->hasBudget();
+    if (!_donatingSlice)
+    {
+        reset_timer();
+    }
+    end_slice(false);
+    set_state(_runningThread, READY);
+    push_to_readyThreads(_runningThread);
+
+    int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
+    if (ret_val == 0)
+    {
+        changeStateToRunning();
+    }
+}
+
+void sync_handler::yield_to(int id, bool donateSlice)
+{
+    block_maskedSignals();
+    Thread* target = _allThreads[id];
+    if (target->getState() == READY)
+    {
+        switch_to(target, donateSlice);
+    }
+    unblock_maskedSignals();
+}
+
+/**
+ * A thread blocked by uthread_block, parked or sleeping is woken as by uthread_resume; one also
+ * waiting for the mutex stays there and gets no CPU.
+ */
+void sync_handler::resume_and_switch(int id, bool donateSlice)
+{
+    block_maskedSignals();
+    Thread* target = _allThreads[id];
+    if (target->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        _blockedThreads.erase(id);
+        set_state(target, BLOCKED_MUTEX);
+    }
+    else if (target->getState() == BLOCKED)
+    {
+        _blockedThreads.erase(id);
+        changeStateToReady(id);
+    }
+    if (target->getState() == READY)
+    {
+        switch_to(target, donateSlice);
+    }
+    unblock_maskedSignals();
+}
+
+/**
+ * Blocks a batch of threads in one critical section. The calling thread may be in the batch; it
+ * switches away once all the others are blocked.
+ * @return false, blocking nothing, if an ID does not exist or is the main thread's.
+ */
+bool sync_handler::block_many(const int ids[], int count)
+{
+    Thread* threads[MAX_THREAD_NUM];
+    Thread* leaving[MAX_THREAD_NUM];
+    int leavingCount = 0;
+    bool blocksItself = false;
+
+    block_maskedSignals();
+    for (int i = 0; i < count; ++i)
+    {
+        auto found = _allThreads.find(ids[i]);
+        if (found == _allThreads.end() || ids[i] == 0)
+        {
+            unblock_maskedSignals();
+            return false;
+        }
+        threads[i] = found->second;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        Thread* thread = threads[i];
+        int state = thread->getState();
+        if (state == BLOCKED || state == BLOCKED_AND_BLOCKED_MUTEX)
+        {
+            continue;
+        }
+        if (state == READY)
+        {
+            leaving[leavingCount++] = thread;
+        }
+        else if (state == THROTTLED)
+        {
+            unthrottle(thread);
+        }
+        blocksItself = blocksItself || (state == RUNNING);
+        set_state(thread, (state == BLOCKED_MUTEX) ? BLOCKED_AND_BLOCKED_MUTEX : BLOCKED);
+        _blockedThreads[thread->getId()] = thread;
+    }
+    remove_many_from_readyThreads(leaving, leavingCount);
+
+    if (blocksItself)
+    {
+        reset_timer();
+        end_slice(false);
+        int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
+        if (ret_val == 0)
+        {
+            changeStateToRunning();
+        }
+    }
+    unblock_maskedSignals();
+    return true;
+}
+
+/**
+ * Resumes a batch of threads in one critical section and queues the woken ones with a single
+ * splice. Threads that are not blocked are left alone.
+ * @return false, resuming nothing, if an ID does not exist.
+ */
+bool sync_handler::resume_many(const int ids[], int count)
+{
+    Thread* threads[MAX_THREAD_NUM];
+    Thread* woken[MAX_THREAD_NUM];
+    int wokenCount = 0;
+
+    block_maskedSignals();
+    for (int i = 0; i < count; ++i)
+    {
+        auto found = _allThreads.find(ids[i]);
+        if (found == _allThreads.end())
+        {
+            unblock_maskedSignals();
+            return false;
+        }
+        threads[i] = found->second;
+    }
+
+    Thread* earliest = nullptr;
+    for (int i = 0; i < count; ++i)
+    {
+        Thread* thread = threads[i];
+        if (thread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+        {
+            _blockedThreads.erase(thread->getId());
+            set_state(thread, BLOCKED_MUTEX);
+        }
+        else if (thread->getState() == BLOCKED)
+        {
+            _blockedThreads.erase(thread->getId());
+            set_state(thread, READY);
+            woken[wokenCount++] = thread;
+            if (thread->hasBudget() &&
+                (earliest == nullptr || thread->getDeadlineUsecs() < earliest->getDeadlineUsecs()))
+            {
+                earliest = thread;
+            }
+        }
+    }
+    push_many_to_readyThreads(woken, wokenCount);
+
+    if (earliest != nullptr)
+    {
+        preempt_for_deadline(earliest);
+    }
+    unblock_maskedSignals();
+    return true;
+}
+
+void sync_handler::init_timer()
+{
+    _sa.sa_sigaction = &sigvtalrm_handler;
+    // a wall-clock timer may fire while a thread sits in a system call
+    _sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    // CPU-time timers expire on the same kernel tick, and a sample of the handler is worthless:
+    // it waits for the thread that gets the CPU next
+    sigemptyset(&_sa.sa_mask);
+    sigaddset(&_sa.sa_mask, SIGPROF);
+
+    if (sigaction(SIGVTALRM, &_sa, NULL) < 0)
+    {
+        exit_and_print_error(SIGACTION_ERR_MSG);
+    }
+
+    if (_timerBackend == UTHREAD_TIMER_MONOTONIC)
+    {
+        init_posix_timer(CLOCK_MONOTONIC);
+    }
+    else if (_timerBackend == UTHREAD_TIMER_THREAD_CPU)
+    {
+        init_posix_timer(CLOCK_THREAD_CPUTIME_ID);
+    }
+}
+
+/**
+ * Creates a POSIX timer on the given clock that delivers SIGVTALRM to the calling kernel thread
+ * only, so the signal never lands on another thread of the process.
+ */
+void sync_handler::init_posix_timer(clockid_t clock)
+{
+    struct sigevent sev = {};
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGVTALRM;
+    sev.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+
+    if (timer_create(clock, &sev, &_posixTimer) < SUCCESS)
+    {
+        exit_and_print_error(TIMER_CREATE_ERR_MSG);
+    }
+}
+
+void sync_handler::init_mutex()
+{
+    _mutex = PTHREAD_MUTEX_INITIALIZER;
+    _mutexThreadId = UNLOCKED;
+    if (pthread_mutex_init(&_mutex, nullptr) != SUCCESS)
+    {
+        // TODO check if we want to terminate.
+        exit_and_print_error(INIT_MUTEX_ERR);
+    }
+}
+
+void sync_handler::set_interval_timer()
+{
+    if (_timerBackend == UTHREAD_TIMER_SIMULATED)
+    {
+        set_simulated_slice();
+        return;
+    }
+    if (_timerBackend == UTHREAD_TIMER_VIRTUAL)
+    {
+        if (setitimer (ITIMER_VIRTUAL, &_timer, NULL)) {
+            exit_and_print_error(SETITIMER_ERR_MSG);
+        }
+        return;
+    }
+
+    struct itimerspec spec;
+    spec.it_value.tv_sec = _timer.it_value.tv_sec;
+    spec.it_value.tv_nsec = _timer.it_value.tv_usec * NANO_SECONDS_IN_MICRO;
+    spec.it_interval.tv_sec = _timer.it_interval.tv_sec;
+    spec.it_interval.tv_nsec = _timer.it_interval.tv_usec * NANO_SECONDS_IN_MICRO;
+    if (timer_settime(_posixTimer, 0, &spec, NULL) < SUCCESS)
+    {
+        exit_and_print_error(TIMER_SETTIME_ERR_MSG);
+    }
+}
+
+void sync_handler::set_timer()
+{
+    int quantum = _runningThread->getQuantumUsecs();
+    bool timeSliced = SchedPolicy::TIME_SLICED || _schedPolicy == UTHREAD_SCHED_FAIR ||
+                      _runningThread->hasBudget();
+    if (!_deadlineThreads.empty() || !_sleepingThreads.empty() || !_throttledThreads.empty() ||
+        _runningThread->hasCpuQuota())
+    {
+        quantum = bound_quantum_by_deadlines(timeSliced ? quantum : INT_MAX);
+    }
+    else if (!timeSliced)
+    {
+        // nothing to bound and nobody to take turns with: the thread runs until it gives up the CPU
+        reset_timer();
+        return;
+    }
+    _timer.it_value.tv_sec = quantum / MICRO_SECONDS;
+    _timer.it_value.tv_usec = quantum % MICRO_SECONDS;
+
+    _timer.it_interval.tv_sec = RESET_TIMER;
+    _timer.it_interval.tv_usec = RESET_TIMER;
+
+    set_interval_timer();
+}
+
+void sync_handler::reset_timer()
+{
+    _timer.it_value.tv_sec = RESET_TIMER;
+    _timer.it_value.tv_usec = RESET_TIMER;
+
+    _timer.it_interval.tv_sec = RESET_TIMER;
+    _timer.it_interval.tv_usec = RESET_TIMER;
+
+    set_interval_timer();
+}
+
+bool sync_handler::can_add_new_thread()
+{
+    return (_allThreads.size() < MAX_THREAD_NUM);
+}
+
+bool sync_handler::can_add_new_threads(int count)
+{
+    return (_allThreads.size() + count <= MAX_THREAD_NUM);
+}
+
+Thread* sync_handler::get_thread_by_id(int id)
+{
+    auto thread = _allThreads.find(id);
+    if(thread == _allThreads.end())
+    {
+        return nullptr;
+    }
+    return thread->second;
+}
+
+void sync_handler::release_resources_by_thread(int id)
+{
+    block_maskedSignals();
+    Thread* threadToTerminate = _allThreads[id];
+    if (threadToTerminate->getState() == BLOCKED ||
+    threadToTerminate->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        _blockedThreads.erase(id);
+    }
+    if (threadToTerminate->getState() == READY)
+    {
+        remove_from_readyThreads(threadToTerminate);
+    }
+    detach_thread(threadToTerminate);
+    delete(threadToTerminate);
+    unblock_maskedSignals();
+}
+
+/**
+ * Drops a terminating thread from every structure but the run queues and frees its ID. The
+ * Thread itself is left to the caller. The caller must have the signals blocked.
+ */
+void sync_handler::detach_thread(Thread* thread)
+{
+    int id = thread->getId();
+    if (thread->getState() == BLOCKED_MUTEX ||
+    thread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        _mutexBlockedThreads.erase(std::find(_mutexBlockedThreads.begin(),
+                                             _mutexBlockedThreads.end(), id));
+        refresh_mutex_boost();
+    }
+    if (thread->isDeadlineThread())
+    {
+        _deadlineUtilization -= utilization_of(thread);
+        _deadlineThreads.erase(id);
+    }
+    if (thread->getWakeUsecs() != 0)
+    {
+        _sleepingThreads.erase(std::make_pair(thread->getWakeUsecs(), id));
+    }
+    if (thread->getState() == THROTTLED)
+    {
+        unthrottle(thread);
+    }
+    if (thread->hasCpuQuota())
+    {
+        _quotaThreadCount--;
+    }
+    forget_rcu_thread(id);
+    run_key_destructors(thread);
+    if (thread->isStackPainted())
+    {
+        record_stack_peak(thread);
+    }
+    if (thread->getGroup() != NO_GROUP)
+    {
+        _groups[thread->getGroup()]->removeMember(thread);
+    }
+    _allThreads.erase(id);
+    // a terminated owner would keep the mutex locked for good, and its ID may be reused
+    if (_mutexThreadId == id)
+    {
+        if (_lockProfiling)
+        {
+            LockProfiler::released(id);
+        }
+        release_mutex();
+    }
+    _nextAvailableID.push(id);
+    if (_metrics != nullptr)
+    {
+        begin_metrics_update();
+        _metrics->threads[id].state = UTHREAD_METRICS_FREE;
+        _metrics->threads[id].quantums = 0;
+        end_metrics_update();
+    }
+}
+
+/**
+ * Terminates the running thread, which must not be the main thread, and switches to the next
+ * one. Does not return.
+ */
+void sync_handler::terminate_running_thread()
+{
+    block_maskedSignals();
+    reset_timer();
+    end_slice(false);
+    reap_zombie_thread();
+    detach_thread(_runningThread);
+    _zombieThread = _runningThread;
+    changeStateToRunning();
+}
+
+/**
+ * Paints the stack of a new thread when profiling is on and counts it under its entry function.
+ */
+void sync_handler::profile_new_stack(Thread* thread)
+{
+    if (!_stackProfiling)
+    {
+        return;
+    }
+    thread->paintStack();
+    _entryStackPeaks[thread->getEntry()].second++;
+}
+
+/**
+ * Folds the peak of a profiled thread that is going away into its entry function's peak.
+ */
+void sync_handler::record_stack_peak(Thread* thread)
+{
+    std::pair<size_t, int>& entry = _entryStackPeaks[thread->getEntry()];
+    size_t peak = thread->getStackPeak();
+    if (peak > entry.first)
+    {
+        entry.first = peak;
+    }
+}
+
+/**
+ * Deletes the last thread that terminated itself, once the CPU has left its stack.
+ */
+void sync_handler::reap_zombie_thread()
+{
+    if (_zombieThread != nullptr && _zombieThread != _runningThread)
+    {
+        delete _zombieThread;
+        _zombieThread = nullptr;
+    }
+}
+
+void sync_handler::remove_from_readyThreads(Thread* threadToRemove)
+{
+    if (threadToRemove == _runNextThread)
+    {
+        _runNextThread = nullptr;
+        if (threadToRemove->isLatencySensitive())
+        {
+            _latencySensitiveReady--;
+        }
+        return;
+    }
+
+    if (_deadlineReadyThreads.erase(std::make_pair(threadToRemove->getDeadlineUsecs(),
+                                                   threadToRemove->getId())))
+    {
+        if (threadToRemove->isLatencySensitive())
+        {
+            _latencySensitiveReady--;
+        }
+        return;
+    }
+
+    if (_schedPolicy == UTHREAD_SCHED_FAIR)
+    {
+        if (_fairReadyThreads.erase(std::make_pair(threadToRemove->getVruntime(),
+                                                   threadToRemove->getId())) &&
+            threadToRemove->isLatencySensitive())
+        {
+            _latencySensitiveReady--;
+        }
+        return;
+    }
+
+    if (_readyThreads.remove(threadToRemove) && threadToRemove->isLatencySensitive())
+    {
+        _latencySensitiveReady--;
+    }
+}
+
+/**
+ * Queues the running thread when its slice ends. Only the best-effort queue treats it differently
+ * from a thread that has just become READY.
+ */
+void sync_handler::push_preempted_to_readyThreads(Thread* thread)
+{
+    if (throttle_if_over_quota(thread))
+    {
+        return;
+    }
+    if (thread->hasBudget() || _schedPolicy == UTHREAD_SCHED_FAIR)
+    {
+        push_to_readyThreads(thread);
+        return;
+    }
+    _readyThreads.pushPreempted(thread);
+    if (thread->isLatencySensitive())
+    {
+        _latencySensitiveReady++;
+    }
+}
+
+void sync_handler::push_to_readyThreads(Thread* thread)
+{
+    if (throttle_if_over_quota(thread))
+    {
+        return;
+    }
+    if (thread->hasBudget())
+    {
+        _deadlineReadyThreads.insert(std::make_pair(thread->getDeadlineUsecs(), thread->getId()));
+    }
+    else if (_schedPolicy == UTHREAD_SCHED_FAIR)
+    {
+        // a sleeper keeps at most one quantum of credit over the threads that kept running
+        unsigned long long credit = (unsigned long long) _quantumSecs * VRUNTIME_SCALE;
+        unsigned long long floor = (_minVruntime > credit) ? _minVruntime - credit : 0;
+        if (thread->getVruntime() < floor)
+        {
+            thread->setVruntime(floor);
+        }
+        _fairReadyThreads.insert(std::make_pair(thread->getVruntime(), thread->getId()));
+    }
+    else
+    {
+        _readyThreads.push(thread);
+    }
+
+    if (thread->isLatencySensitive())
+    {
+        _latencySensitiveReady++;
+    }
+}
+
+/**
+ * Queues a batch of threads that became READY.
+ */
+void sync_handler::push_many_to_readyThreads(Thread** threads, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        push_to_readyThreads(threads[i]);
+    }
+}
+
+/**
+ * Takes a batch of READY threads out of the ready queues, with a single pass over the
+ * round-robin queue.
+ */
+void sync_handler::remove_many_from_readyThreads(Thread** threads, int count)
+{
+    bool leaving[MAX_THREAD_NUM] = {false};
+    bool anyRoundRobin = false;
+    for (int i = 0; i < count; ++i)
+    {
+        Thread* thread = threads[i];
+        if (thread->hasBudget() || _schedPolicy == UTHREAD_SCHED_FAIR || thread == _runNextThread)
+        {
+            remove_from_readyThreads(thread);
+            continue;
+        }
+        leaving[thread->getId()] = true;
+        anyRoundRobin = true;
+        if (thread->isLatencySensitive())
+        {
+            _latencySensitiveReady--;
+        }
+    }
+    if (anyRoundRobin)
+    {
+        _readyThreads.removeMarked(leaving);
+    }
+}
+
+Thread* sync_handler::pop_from_readyThreads()
+{
+    Thread* thread;
+    if (!_deadlineReadyThreads.empty())
+    {
+        thread = _allThreads[_deadlineReadyThreads.begin()->second];
+        _deadlineReadyThreads.erase(_deadlineReadyThreads.begin());
+    }
+    else if (_runNextThread != nullptr && can_run_next())
+    {
+        thread = _runNextThread;
+        _runNextThread = nullptr;
+        if (_runNextStreakStartUsecs == 0)
+        {
+            _runNextStreakStartUsecs = now_usecs();
+        }
+    }
+    else if (_schedPolicy == UTHREAD_SCHED_FAIR)
+    {
+        // a pick from the queue ends the run of slot picks, and a thread left in the slot waits
+        // its turn behind the others
+        _runNextStreakStartUsecs = 0;
+        flush_run_next();
+        thread = _allThreads[_fairReadyThreads.begin()->second];
+        _fairReadyThreads.erase(_fairReadyThreads.begin());
+        if (thread->getVruntime() > _minVruntime)
+        {
+            _minVruntime = thread->getVruntime();
+        }
+    }
+    else
+    {
+        _runNextStreakStartUsecs = 0;
+        flush_run_next();
+        thread = _allThreads[_readyThreads.pop()];
+    }
+
+    if (thread->isLatencySensitive())
+    {
+        _latencySensitiveReady--;
+    }
+    return thread;
+}
+
+/**
+ * Slices are only timed when some policy needs the run lengths.
+ */
+bool sync_handler::is_tracking_slices()
+{
+    return _adaptiveQuantum || _schedPolicy == UTHREAD_SCHED_FAIR || !_deadlineThreads.empty() ||
+           _groupCount > 0 || _quotaThreadCount > 0;
+}
+
+/**
+ * Releases the jobs of deadline threads whose period has started, and counts a miss for every
+ * job still unfinished at its deadline (that job is dropped and the next one released).
+ */
+void sync_handler::release_deadline_threads()
+{
+    if (_deadlineThreads.empty())
+    {
+        return;
+    }
+    long long now = now_usecs();
+    for (int id : _deadlineThreads)
+    {
+        Thread* thread = _allThreads[id];
+        if (thread->getDeadlineUsecs() > now)
+        {
+            continue;
+        }
+
+        bool waiting = (thread->getState() == WAITING_PERIOD);
+        bool queued = (thread->getState() == READY);
+        if (queued)
+        {
+            remove_from_readyThreads(thread);
+        }
+        if (!waiting)
+        {
+            thread->increaseDeadlineMisses();
+        }
+        do
+        {
+            thread->startNextJob();
+        } while (!waiting && thread->getDeadlineUsecs() <= now);
+
+        if (waiting)
+        {
+            set_state(thread, READY);
+            push_to_readyThreads(thread);
+        }
+        else if (queued)
+        {
+            push_to_readyThreads(thread);
+        }
+    }
+}
+
+/**
+ * Shortens the next slice so the timer fires when the running deadline job runs out of budget,
+ * when a waiting deadline thread is released or when a sleeping thread is due.
+ */
+int sync_handler::bound_quantum_by_deadlines(int quantum)
+{
+    if (_runningThread->hasBudget() && _runningThread->getBudgetLeftUsecs() < quantum)
+    {
+        quantum = _runningThread->getBudgetLeftUsecs();
+    }
+    if (_runningThread->hasCpuQuota() && _runningThread->getQuotaLeftUsecs() < quantum)
+    {
+        quantum = _runningThread->getQuotaLeftUsecs();
+    }
+    long long release = next_wakeup_usecs();
+    if (release != FAIL && release - now_usecs() < quantum)
+    {
+        quantum = (int) (release - now_usecs());
+    }
+    return (quantum > 0) ? quantum : 1;
+}
+
+/**
+ * @return the earliest release time of a WAITING_PERIOD thread, or -1 if none is waiting.
+ */
+long long sync_handler::next_release_usecs()
+{
+    long long release = FAIL;
+    for (int id : _deadlineThreads)
+    {
+        Thread* thread = _allThreads[id];
+        if (thread->getState() == WAITING_PERIOD &&
+            (release == FAIL || thread->getDeadlineUsecs() < release))
+        {
+            release = thread->getDeadlineUsecs();
+        }
+    }
+    return release;
+}
+
+/**
+ * @return the earliest time a deadline release, a sleeper's wake-up or the end of a throttle is
+ * due, -1 if none is.
+ */
+long long sync_handler::next_wakeup_usecs()
+{
+    long long wakeup = next_release_usecs();
+    if (!_sleepingThreads.empty() &&
+        (wakeup == FAIL || _sleepingThreads.begin()->first < wakeup))
+    {
+        wakeup = _sleepingThreads.begin()->first;
+    }
+    if (!_throttledThreads.empty() &&
+        (wakeup == FAIL || _throttledThreads.begin()->first < wakeup))
+    {
+        wakeup = _throttledThreads.begin()->first;
+    }
+    return wakeup;
+}
+
+/**
+ * Wakes the sleeping and timed-parked threads whose time has come.
+ */
+void sync_handler::release_sleeping_threads()
+{
+    long long now = now_usecs();
+    while (!_sleepingThreads.empty() && _sleepingThreads.begin()->first <= now)
+    {
+        Thread* thread = _allThreads[_sleepingThreads.begin()->second];
+        _sleepingThreads.erase(_sleepingThreads.begin());
+        thread->setWakeUsecs(0);
+        thread->setParked(false);
+        if (thread->getState() == BLOCKED)
+        {
+            _blockedThreads.erase(thread->getId());
+            changeStateToReady(thread->getId());
+        }
+    }
+}
+
+/**
+ * Handles the wakeups posted by uthread_resume_remote: a blocked or parked thread becomes READY,
+ * any other thread gets a park permit. The IDs of threads terminated meanwhile are skipped.
+ */
+void sync_handler::release_remote_threads()
+{
+    for (int word = 0; word < REMOTE_WAKEUP_WORDS; ++word)
+    {
+        if (_remoteWakeups[word].load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        unsigned long long pending = _remoteWakeups[word].exchange(0, std::memory_order_acquire);
+        while (pending != 0)
+        {
+            int id = word * 64 + __builtin_ctzll(pending);
+            pending &= pending - 1;
+
+            auto found = _allThreads.find(id);
+            if (found == _allThreads.end())
+            {
+                continue;
+            }
+            Thread* thread = found->second;
+            if (thread->getState() == BLOCKED)
+            {
+                thread->setParked(false);
+                _blockedThreads.erase(id);
+                changeStateToReady(id);
+            }
+            else if (thread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+            {
+                thread->setParked(false);
+                _blockedThreads.erase(id);
+                set_state(thread, BLOCKED_MUTEX);
+            }
+            else
+            {
+                thread->setParkPermit(true);
+            }
+        }
+    }
+}
+
+/**
+ * Makes READY every thread woken since the last scheduling point: released deadline jobs, due
+ * sleepers, throttled threads whose quota is refilled and remote wakeups.
+ */
+void sync_handler::release_woken_threads()
+{
+    release_deadline_threads();
+    if (!_sleepingThreads.empty())
+    {
+        release_sleeping_threads();
+    }
+    if (!_throttledThreads.empty())
+    {
+        release_throttled_threads();
+    }
+    release_remote_threads();
+}
+
+/**
+ * Throttles a thread about to be queued if it used up its CPU quota for the current period: it
+ * is THROTTLED instead of READY until the period ends. Deadline threads are held to their budget
+ * instead.
+ * @return true if the thread was throttled.
+ */
+bool sync_handler::throttle_if_over_quota(Thread* thread)
+{
+    if (!thread->hasCpuQuota() || thread->isDeadlineThread())
+    {
+        return false;
+    }
+    long long now = now_usecs();
+    thread->refillQuota(now);
+    if (!thread->isOverQuota())
+    {
+        return false;
+    }
+    set_state(thread, THROTTLED);
+    thread->startThrottle(now);
+    _throttledThreads.insert(std::make_pair(thread->getQuotaPeriodEndUsecs(), thread->getId()));
+    return true;
+}
+
+/**
+ * Takes a THROTTLED thread out of the throttled set, leaving its new state to the caller.
+ */
+void sync_handler::unthrottle(Thread* thread)
+{
+    _throttledThreads.erase(std::make_pair(thread->getQuotaPeriodEndUsecs(), thread->getId()));
+    thread->endThrottle(now_usecs());
+}
+
+/**
+ * Makes READY the throttled threads whose quota period is over.
+ */
+void sync_handler::release_throttled_threads()
+{
+    long long now = now_usecs();
+    while (!_throttledThreads.empty() && _throttledThreads.begin()->first <= now)
+    {
+        Thread* thread = _allThreads[_throttledThreads.begin()->second];
+        _throttledThreads.erase(_throttledThreads.begin());
+        thread->endThrottle(now);
+        thread->refillQuota(now);
+        changeStateToReady(thread->getId());
+    }
+}
+
+bool sync_handler::has_ready_threads()
+{
+    return !_readyThreads.empty() || !_fairReadyThreads.empty() || !_deadlineReadyThreads.empty() ||
+           _runNextThread != nullptr;
+}
+
+/**
+ * Parks the kernel thread while no thread is READY. The quantum timer is disarmed, so an idle
+ * process uses no CPU; it wakes up when the next deadline thread or sleeper is due, when a signal
+ * handler makes a thread READY or when uthread_resume_remote writes the wakeup eventfd. The
+ * signals are blocked on entry and stay blocked on return.
+ */
+void sync_handler::idle_until_ready()
+{
+    reset_timer();
+    _idle = true;
+    if (_metrics != nullptr)
+    {
+        publish_metrics(nullptr);
+    }
+
+    sigset_t idleMask;
+    sigprocmask(SIG_BLOCK, NULL, &idleMask);
+    sigdelset(&idleMask, SIGVTALRM);
+
+    struct pollfd wakeup;
+    wakeup.fd = _wakeupFd;
+    wakeup.events = POLLIN;
+
+    while (!has_ready_threads())
+    {
+        long long release = next_wakeup_usecs();
+        if (release != FAIL && is_simulated())
+        {
+            // nothing runs until the next wakeup, so virtual time skips straight to it
+            if (release > _simNowUsecs)
+            {
+                _simNowUsecs = release;
+            }
+            release_woken_threads();
+            continue;
+        }
+        struct timespec timeout;
+        if (release != FAIL)
+        {
+            long long wait = release - now_usecs();
+            wait = (wait > 0) ? wait : 0;
+            timeout.tv_sec = wait / MICRO_SECONDS;
+            timeout.tv_nsec = (wait % MICRO_SECONDS) * NANO_SECONDS_IN_MICRO;
+        }
+        wakeup.revents = 0;
+        if (ppoll(&wakeup, 1, (release != FAIL) ? &timeout : NULL, &idleMask) < SUCCESS &&
+            errno != EINTR)
+        {
+            exit_and_print_error(PPOLL_ERR_MSG);
+        }
+        if (wakeup.revents & POLLIN)
+        {
+            // re-arm the kick before the bits are taken, so a wakeup posted from here on
+            // writes the eventfd again
+            _wakeupKicked = false;
+            eventfd_t count;
+            eventfd_read(_wakeupFd, &count);
+        }
+        release_woken_threads();
+    }
+
+    _idle = false;
+    if (is_tracking_slices())
+    {
+        // the time spent idle is nobody's run time
+        _sliceStartUsecs = now_usecs();
+    }
+}
+
+long long sync_handler::utilization_of(Thread* thread)
+{
+    return (long long) thread->getBudgetUsecs() * MICRO_SECONDS / thread->getPeriodUsecs();
+}
+
+/**
+ * Accounts the running thread's slice before it leaves the CPU. Must run before the thread is
+ * queued again, since its latency-sensitive class may change here.
+ * @param exhaustedQuantum true when the thread was preempted by the timer.
+ */
+void sync_handler::end_slice(bool exhaustedQuantum)
+{
+    if (!is_tracking_slices())
+    {
+        return;
+    }
+    long long now = now_usecs();
+    int runUsecs = (int) (now - _sliceStartUsecs);
+    _runningThread->recordRun(runUsecs, exhaustedQuantum);
+    _runningThread->chargeRuntime(runUsecs);
+    if (_runningThread->getGroup() != NO_GROUP)
+    {
+        _groups[_runningThread->getGroup()]->chargeRuntime(runUsecs);
+    }
+    if (_runningThread->isDeadlineThread())
+    {
+        _runningThread->chargeBudget(runUsecs);
+    }
+    else if (_runningThread->hasCpuQuota())
+    {
+        _runningThread->refillQuota(now);
+        _runningThread->chargeQuota(runUsecs);
+    }
+    _sliceStartUsecs = now;
+}
+
+/**
+ * Picks the slice for a thread about to run. CPU-bound threads double their slice while no
+ * latency-sensitive thread is waiting and halve it under contention; latency-sensitive threads
+ * get about twice their usual run length.
+ */
+int sync_handler::choose_quantum(Thread* thread)
+{
+    if (!_adaptiveQuantum)
+    {
+        return _quantumSecs;
+    }
+
+    int quantum = thread->getQuantumUsecs();
+    if (thread->isLatencySensitive())
+    {
+        quantum = 2 * thread->getAvgRunUsecs();
+    }
+    else if (_latencySensitiveReady > 0)
+    {
+        quantum /= 2;
+    }
+    else
+    {
+        quantum = (quantum > _maxQuantumUsecs / 2) ? _maxQuantumUsecs : 2 * quantum;
+    }
+
+    if (quantum < _minQuantumUsecs)
+    {
+        return _minQuantumUsecs;
+    }
+    return (quantum > _maxQuantumUsecs) ? _maxQuantumUsecs : quantum;
+}
+
+void sync_handler::release_all_resources()
+{
+    block_maskedSignals();
+    // a wall-clock timer keeps firing on its own, stop it before the containers go away
+    reset_timer();
+    if (_wakeupFd != FAIL)
+    {
+        close(_wakeupFd);
+        _wakeupFd = FAIL;
+    }
+    _simRecordFd = FAIL;
+    _simReplay.clear();
+    if (_profileTimerCreated)
+    {
+        timer_delete(_profileTimer);
+        _profileTimerCreated = false;
+    }
+    _profiling = false;
+    _lockProfiling = false;
+    unmap_metrics();
+    for (auto th : _allThreads)
+    {
+        delete(th.second);
+    }
+    delete _zombieThread;
+    _zombieThread = nullptr;
+    delete _sharedArena;
+    _sharedArena = nullptr;
+    for (int group = 0; group < UTHREAD_GROUPS_MAX; ++group)
+    {
+        delete _groups[group];
+        _groups[group] = nullptr;
+    }
+    _readyThreads.clear();
+    _runNextThread = nullptr;
+    _fairReadyThreads.clear();
+    _deadlineReadyThreads.clear();
+    _deadlineThreads.clear();
+    _sleepingThreads.clear();
+    _throttledThreads.clear();
+    _quotaThreadCount = 0;
+    _rcuNext.clear();
+    _rcuCurrent.clear();
+    _rcuDone.clear();
+    _rcuSynchronizers.clear();
+    _rcuGracePeriod = false;
+    _rcuWaitingCount = 0;
+    _latencySensitiveReady = 0;
+    _blockedThreads.clear();
+    // todo check if need to delete priority queue
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_running_thread_id()
+{
+    return _runningThread->getId();
+}
+
+int sync_handler::get_mutex_thread_id()
+{
+    return _mutexThreadId;
+}
+
+int sync_handler::get_total_quantums()
+{
+    return _totalQuantumCount;
+}
+
+int sync_handler::get_quantums_by_id(int id)
+{
+    return _allThreads[id]->getQuantumCount();
+}
+
+void sync_handler::set_adaptive_quantum(int min_usecs, int max_usecs)
+{
+    block_maskedSignals();
+    _minQuantumUsecs = min_usecs;
+    _maxQuantumUsecs = max_usecs;
+    if (!is_tracking_slices())
+    {
+        _sliceStartUsecs = now_usecs();
+    }
+    _adaptiveQuantum = true;
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_quantum_usecs_by_id(int id)
+{
+    return _allThreads[id]->getQuantumUsecs();
+}
+
+/**
+ * Switches the ready queue to the given policy, moving the READY threads over in the order the
+ * old policy would have run them.
+ */
+void sync_handler::set_sched_policy(int policy)
+{
+    block_maskedSignals();
+    if (policy != _schedPolicy)
+    {
+        std::vector<Thread*> ready;
+        while (!_readyThreads.empty() || !_fairReadyThreads.empty())
+        {
+            ready.push_back(pop_from_readyThreads());
+        }
+        if (!is_tracking_slices())
+        {
+            _sliceStartUsecs = now_usecs();
+        }
+        _schedPolicy = policy;
+        for (Thread* thread : ready)
+        {
+            push_to_readyThreads(thread);
+        }
+    }
+    unblock_maskedSignals();
+}
+
+void sync_handler::set_weight(int id, int weight)
+{
+    block_maskedSignals();
+    _allThreads[id]->setWeight(weight);
+    unblock_maskedSignals();
+}
+
+/**
+ * Turns the run-next slot on or off; turning it off queues the thread waiting in it.
+ */
+void sync_handler::set_run_next(bool enable)
+{
+    block_maskedSignals();
+    _runNextEnabled = enable;
+    if (!enable)
+    {
+        flush_run_next();
+    }
+    unblock_maskedSignals();
+}
+
+void sync_handler::set_cpu_quota(int id, int quota_usecs, int period_usecs)
+{
+    block_maskedSignals();
+    Thread* thread = _allThreads[id];
+    if (!is_tracking_slices())
+    {
+        _sliceStartUsecs = now_usecs();
+    }
+    bool throttled = (thread->getState() == THROTTLED);
+    if (throttled)
+    {
+        unthrottle(thread);
+    }
+    _quotaThreadCount += (period_usecs > 0) - thread->hasCpuQuota();
+    thread->setCpuQuota(quota_usecs, period_usecs, now_usecs());
+    if (throttled)
+    {
+        // a fresh quota, so the thread may run again
+        changeStateToReady(id);
+    }
+    if (thread == _runningThread)
+    {
+        set_timer();
+    }
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_throttle_count(int id)
+{
+    return _allThreads[id]->getThrottleCount();
+}
+
+long long sync_handler::get_throttled_usecs(int id)
+{
+    return _allThreads[id]->getThrottledUsecs(now_usecs());
+}
+
+/**
+ * Requeues a READY thread so the priority ready queue files it under its new level.
+ */
+void sync_handler::set_priority(int id, int priority)
+{
+    block_maskedSignals();
+    Thread* thread = _allThreads[id];
+    bool queued = (thread->getState() == READY);
+    if (queued)
+    {
+        remove_from_readyThreads(thread);
+    }
+    thread->setPriority(priority, now_usecs());
+    if (queued)
+    {
+        push_to_readyThreads(thread);
+    }
+    // the thread may hold the mutex or wait for it
+    refresh_mutex_boost();
+    unblock_maskedSignals();
+}
+
+/**
+ * Lends the mutex owner the highest priority among the threads waiting for it, or takes the loan
+ * back when no waiter outranks the owner any more. The caller must have the signals blocked.
+ */
+void sync_handler::refresh_mutex_boost()
+{
+    if (_mutexThreadId == UNLOCKED)
+    {
+        return;
+    }
+    Thread* owner = get_thread_by_id(_mutexThreadId);
+    if (owner == nullptr)
+    {
+        return;
+    }
+    int inherited = NO_INHERITED_PRIORITY;
+    for (int id : _mutexBlockedThreads)
+    {
+        int priority = _allThreads[id]->getEffectivePriority();
+        if (priority > inherited)
+        {
+            inherited = priority;
+        }
+    }
+    if (inherited <= owner->getPriority())
+    {
+        inherited = NO_INHERITED_PRIORITY;
+    }
+    if (inherited != owner->getInheritedPriority())
+    {
+        set_inherited_priority(owner, inherited);
+    }
+}
+
+/**
+ * Requeues a READY thread around the change, as the ready queue may file it by priority.
+ */
+void sync_handler::set_inherited_priority(Thread* thread, int priority)
+{
+    bool queued = (thread->getState() == READY);
+    if (queued)
+    {
+        remove_from_readyThreads(thread);
+    }
+    thread->setInheritedPriority(priority, now_usecs());
+    if (queued)
+    {
+        push_to_readyThreads(thread);
+    }
+}
+
+int sync_handler::get_boost_count(int id)
+{
+    return _allThreads[id]->getBoostCount();
+}
+
+long long sync_handler::get_boosted_usecs(int id)
+{
+    block_maskedSignals();
+    long long boosted = _allThreads[id]->getBoostedUsecs(now_usecs());
+    unblock_maskedSignals();
+    return boosted;
+}
+
+void sync_handler::set_stack_profiling(bool enable)
+{
+    block_maskedSignals();
+    _stackProfiling = enable;
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_stack_peak(int id)
+{
+    block_maskedSignals();
+    Thread* thread = get_thread_by_id(id);
+    int peak = FAIL;
+    if (thread != nullptr && thread->isStackPainted())
+    {
+        peak = (int) thread->getStackPeak();
+    }
+    unblock_maskedSignals();
+    return peak;
+}
+
+/**
+ * The terminated threads are already folded into the entry's peak, the live ones are scanned now.
+ */
+int sync_handler::get_entry_stack_peak(ThreadEntry f)
+{
+    block_maskedSignals();
+    int peak = FAIL;
+    auto entry = _entryStackPeaks.find(f);
+    if (entry != _entryStackPeaks.end())
+    {
+        size_t deepest = entry->second.first;
+        for (auto th : _allThreads)
+        {
+            Thread* thread = th.second;
+            if (thread->isStackPainted() && thread->getEntry() == f &&
+                thread->getStackPeak() > deepest)
+            {
+                deepest = thread->getStackPeak();
+            }
+        }
+        peak = (int) deepest;
+    }
+    unblock_maskedSignals();
+    return peak;
+}
+
+/**
+ * Writes the live threads by ID, then the entry functions with the live threads folded in.
+ */
+int sync_handler::dump_stack_profile(int fd)
+{
+    block_maskedSignals();
+    std::map<ThreadEntry, std::pair<size_t, int>> entries = _entryStackPeaks;
+    bool ok = dprintf(fd, "stack profile: %d bytes of STACK_SIZE per thread\n"
+                          "%6s %18s %10s %10s\n", STACK_SIZE, "tid", "entry", "peak", "size") >= 0;
+    for (int id = 0; ok && id < MAX_THREAD_NUM; ++id)
+    {
+        Thread* thread = get_thread_by_id(id);
+        if (thread == nullptr || !thread->isStackPainted())
+        {
+            continue;
+        }
+        size_t peak = thread->getStackPeak();
+        std::pair<size_t, int>& entry = entries[thread->getEntry()];
+        if (peak > entry.first)
+        {
+            entry.first = peak;
+        }
+        ok = dprintf(fd, "%6d %18p %10zu %10zu\n", id, (void*) thread->getEntry(), peak,
+                     thread->getStackSize()) >= 0;
+    }
+    if (ok)
+    {
+        ok = dprintf(fd, "%18s %10s %10s\n", "entry", "threads", "peak") >= 0;
+    }
+    for (auto it = entries.begin(); ok && it != entries.end(); ++it)
+    {
+        ok = dprintf(fd, "%18p %10d %10zu\n", (void*) it->first, it->second.second,
+                     it->second.first) >= 0;
+    }
+    unblock_maskedSignals();
+    return ok ? SUCCESS : FAIL;
+}
+
+/**
+ * Admission control: the deadline class may reserve at most DEADLINE_UTILIZATION_LIMIT of the
+ * CPU, so best-effort threads always keep a share.
+ */
+bool sync_handler::can_admit_deadline(int id, int period_usecs, int budget_usecs)
+{
+    long long utilization = _deadlineUtilization;
+    Thread* thread = _allThreads[id];
+    if (thread->isDeadlineThread())
+    {
+        utilization -= utilization_of(thread);
+    }
+    if (period_usecs > 0)
+    {
+        utilization += (long long) budget_usecs * MICRO_SECONDS / period_usecs;
+    }
+    return utilization <= DEADLINE_UTILIZATION_LIMIT;
+}
+
+/**
+ * Moves the thread into the deadline class with its first job released now, or back to
+ * best-effort when period_usecs is 0.
+ */
+void sync_handler::set_deadline(int id, int period_usecs, int budget_usecs)
+{
+    block_maskedSignals();
+    Thread* thread = _allThreads[id];
+    bool queued = (thread->getState() == READY);
+    if (queued)
+    {
+        remove_from_readyThreads(thread);
+    }
+    if (!is_tracking_slices())
+    {
+        _sliceStartUsecs = now_usecs();
+    }
+
+    if (thread->isDeadlineThread())
+    {
+        _deadlineUtilization -= utilization_of(thread);
+        _deadlineThreads.erase(id);
+    }
+    if (thread->getState() == WAITING_PERIOD)
+    {
+        set_state(thread, READY);
+        queued = true;
+    }
+    thread->setDeadlineParams(period_usecs, budget_usecs, now_usecs());
+    if (thread->isDeadlineThread())
+    {
+        _deadlineUtilization += utilization_of(thread);
+        _deadlineThreads.insert(id);
+    }
+
+    if (queued)
+    {
+        push_to_readyThreads(thread);
+        preempt_for_deadline(thread);
+    }
+    unblock_maskedSignals();
+}
+
+/**
+ * Ends the running deadline thread's current job. The thread waits until its next period starts,
+ * unless that has already happened.
+ */
+void sync_handler::wait_next_period()
+{
+    block_maskedSignals();
+    long long now = now_usecs();
+    if (now > _runningThread->getDeadlineUsecs())
+    {
+        // the job overran; release_deadline_threads would have counted it on the next switch
+        _runningThread->increaseDeadlineMisses();
+        while (_runningThread->getDeadlineUsecs() <= now)
+        {
+            _runningThread->startNextJob();
+        }
+        unblock_maskedSignals();
+        return;
+    }
+
+    reset_timer();
+    end_slice(false);
+    set_state(_runningThread, WAITING_PERIOD);
+    int ret_val = sigsetjmp(_runningThread->getEnv(), 1);
+    if (ret_val == 0)
+    {
+        changeStateToRunning();
+    }
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_deadline_misses_by_id(int id)
+{
+    return _allThreads[id]->getDeadlineMisses();
+}
+
+/**
+ * Read-side critical sections cost a counter update on the running thread: no signal masking and
+ * no shared writes. Only leaving the outermost section while a grace period waits for the thread,
+ * or while callbacks are due, takes the slow path, so a reader that is preempted inside its
+ * section every time still lets grace periods end, and their callbacks run. The signal fences
+ * keep the compiler from moving the reader's loads out of the section.
+ */
+void sync_handler::rcu_read_lock()
+{
+    _runningThread->increaseRcuNesting();
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+bool sync_handler::rcu_read_unlock()
+{
+    if (_runningThread->getRcuNesting() == 0)
+    {
+        return false;
+    }
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    _runningThread->decreaseRcuNesting();
+    // a switch after the decrement reports the thread itself, rcu_quiescent checks again
+    if (_runningThread->getRcuNesting() == 0 &&
+        (_rcuWaiting[_runningThread->getId()] || !_rcuDone.empty()))
+    {
+        block_maskedSignals();
+        rcu_quiescent(_runningThread);
+        run_rcu_callbacks();
+    }
+    return true;
+}
+
+bool sync_handler::in_rcu_read_section()
+{
+    return _runningThread->getRcuNesting() > 0;
+}
+
+/**
+ * Starts a grace period for the callbacks retired so far. Only the threads inside a read-side
+ * critical section right now can hold references to them, so only those are waited for; with
+ * none, the grace period is over at once. The caller must have the signals blocked.
+ */
+void sync_handler::start_grace_period()
+{
+    _rcuStarted++;
+    _rcuGracePeriod = true;
+    _rcuNextRequested = false;
+    _rcuCurrent.swap(_rcuNext);
+    _rcuWaitingCount = 0;
+    for (auto& entry : _allThreads)
+    {
+        if (entry.second->getRcuNesting() > 0)
+        {
+            _rcuWaiting[entry.first] = true;
+            _rcuWaitingCount++;
+        }
+    }
+    if (_rcuWaitingCount == 0)
+    {
+        end_grace_period();
+    }
+}
+
+/**
+ * Hands the callbacks of the grace period over to be run, wakes the threads synchronizing on it
+ * and starts the next one if callbacks or synchronizers are waiting. The caller must have the
+ * signals blocked.
+ */
+void sync_handler::end_grace_period()
+{
+    _rcuGracePeriod = false;
+    _rcuCompleted = _rcuStarted;
+    _rcuDone.insert(_rcuDone.end(), _rcuCurrent.begin(), _rcuCurrent.end());
+    _rcuCurrent.clear();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < _rcuSynchronizers.size(); ++i)
+    {
+        if (_rcuSynchronizers[i].first > _rcuCompleted)
+        {
+            _rcuSynchronizers[kept++] = _rcuSynchronizers[i];
+            continue;
+        }
+        int id = _rcuSynchronizers[i].second;
+        if (_allThreads[id]->getState() == BLOCKED)
+        {
+            _blockedThreads.erase(id);
+            changeStateToReady(id);
+        }
+    }
+    _rcuSynchronizers.resize(kept);
+
+    if (!_rcuNext.empty() || _rcuNextRequested)
+    {
+        start_grace_period();
+    }
+}
+
+/**
+ * Called when a thread is switched out or leaves its outermost read-side critical section: with
+ * no section open, it no longer holds references from before the grace period. The caller must
+ * have the signals blocked.
+ */
+void sync_handler::rcu_quiescent(Thread* thread)
+{
+    int id = thread->getId();
+    if (!_rcuWaiting[id] || thread->getRcuNesting() > 0)
+    {
+        return;
+    }
+    _rcuWaiting[id] = false;
+    if (--_rcuWaitingCount == 0)
+    {
+        end_grace_period();
+    }
+}
+
+/**
+ * Drops a terminating thread from the grace period and the synchronizers. The caller must have
+ * the signals blocked.
+ */
+void sync_handler::forget_rcu_thread(int id)
+{
+    for (size_t i = 0; i < _rcuSynchronizers.size(); ++i)
+    {
+        if (_rcuSynchronizers[i].second == id)
+        {
+            _rcuSynchronizers.erase(_rcuSynchronizers.begin() + i);
+            break;
+        }
+    }
+    if (_rcuWaiting[id])
+    {
+        _rcuWaiting[id] = false;
+        if (--_rcuWaitingCount == 0)
+        {
+            end_grace_period();
+        }
+    }
+}
+
+/**
+ * Runs the callbacks whose grace period is over in the calling thread, outside the scheduler's
+ * critical section, so they may free memory or call into the library. The caller must have the
+ * signals blocked; they are unblocked on return.
+ */
+void sync_handler::run_rcu_callbacks()
+{
+    std::vector<RcuCallback> done;
+    done.swap(_rcuDone);
+    unblock_maskedSignals();
+    for (const RcuCallback& callback : done)
+    {
+        callback.fn(callback.ptr);
+    }
+}
+
+void sync_handler::call_rcu(void (*fn)(void*), void* ptr)
+{
+    block_maskedSignals();
+    _rcuNext.push_back(RcuCallback{fn, ptr});
+    if (!_rcuGracePeriod)
+    {
+        start_grace_period();
+    }
+    run_rcu_callbacks();
+}
+
+/**
+ * Blocks the running thread until a grace period that starts after the call is over. The caller
+ * must have the signals blocked; they are blocked again on return.
+ */
+void sync_handler::wait_for_grace_period()
+{
+    // a grace period already under way may have started before the caller's updates
+    long long target = _rcuStarted + 1;
+    if (_rcuGracePeriod)
+    {
+        _rcuNextRequested = true;
+    }
+    else
+    {
+        start_grace_period();
+    }
+    int id = _runningThread->getId();
+    while (_rcuCompleted < target)
+    {
+        _rcuSynchronizers.push_back(std::make_pair(target, id));
+        changeStateToBlocked(id);
+        block_maskedSignals();
+        // a uthread_resume may have woken the thread early
+        forget_rcu_thread(id);
+    }
+}
+
+void sync_handler::synchronize_rcu()
+{
+    block_maskedSignals();
+    wait_for_grace_period();
+    run_rcu_callbacks();
+}
+
+/**
+ * Waits only while callbacks are retired but not yet over their grace period, which the next
+ * grace period covers whether or not one is under way.
+ */
+void sync_handler::rcu_barrier()
+{
+    block_maskedSignals();
+    if (!_rcuNext.empty() || !_rcuCurrent.empty())
+    {
+        wait_for_grace_period();
+    }
+    run_rcu_callbacks();
+}
+
+int sync_handler::lock_mutex(void* caller)
+{
+    // volatile: it is set between sigsetjmp and the siglongjmp back here
+    volatile long long waitStartNsecs = 0;
+    block_maskedSignals();
+    // The location is saved only once the signals are blocked, otherwise a preemption in between
+    // would overwrite it with the handler's frame. A woken waiter comes back here and tries again.
+    while (_mutexThreadId != UNLOCKED)
+    {
+        if (_lockProfiling && waitStartNsecs == 0)
+        {
+            waitStartNsecs = LockProfiler::now_nsecs();
+        }
+        end_slice(false);
+        set_state(_runningThread, BLOCKED_MUTEX);
+        _mutexBlockedThreads.push_back(_runningThread->getId());
+        refresh_mutex_boost();
+        if (sigsetjmp(_runningThread->getEnv(), 1) == 0)
+        {
+            changeStateToRunning(); // puts a new thread in running
+        }
+    }
+
+    if (pthread_mutex_lock(&_mutex) != SUCCESS)
+    {
+        exit_and_print_error(LOCK_FAIL_MSG);
+    }
+    _mutexThreadId = get_running_thread_id();
+    if (_lockProfiling)
+    {
+        LockProfiler::acquired(caller, waitStartNsecs);
+    }
+    // the threads still waiting may outrank the new owner
+    refresh_mutex_boost();
+    unblock_maskedSignals();
+    return SUCCESS;
+}
+
+int sync_handler::unlock_mutex()
+{
+    block_maskedSignals();
+    if (_lockProfiling)
+    {
+        LockProfiler::released(_mutexThreadId);
+    }
+    Thread* woken = release_mutex();
+    if (woken != nullptr)
+    {
+        preempt_for_deadline(woken);
+        preempt_for_priority(woken);
+    }
+    unblock_maskedSignals();
+    return SUCCESS;
+}
+
+/**
+ * Unlocks the mutex, ends the owner's inherited priority and wakes the waiter with the highest
+ * priority, the longest waiting one among equals. The caller must have the signals blocked.
+ * @return the thread that became READY, nullptr if none did.
+ */
+Thread* sync_handler::release_mutex()
+{
+    if (pthread_mutex_unlock(&_mutex) != SUCCESS){
+        exit_and_print_error(UNLOCK_FAIL_MSG);
+    }
+    Thread* owner = get_thread_by_id(_mutexThreadId);
+    if (owner != nullptr && owner->getInheritedPriority() != NO_INHERITED_PRIORITY)
+    {
+        set_inherited_priority(owner, NO_INHERITED_PRIORITY);
+    }
+    _mutexThreadId = UNLOCKED;
+    if (_mutexBlockedThreads.empty())
+    {
+        return nullptr;
+    }
+
+    // Waiters that are also BLOCKED only lose their mutex block, unless no waiter can run now.
+    auto next = _mutexBlockedThreads.end();
+    bool nextRunnable = false;
+    for (auto it = _mutexBlockedThreads.begin(); it != _mutexBlockedThreads.end(); ++it)
+    {
+        Thread* waiter = _allThreads[*it];
+        bool runnable = (waiter->getState() == BLOCKED_MUTEX);
+        if (next == _mutexBlockedThreads.end() || (runnable && !nextRunnable) ||
+            (runnable == nextRunnable &&
+             waiter->getEffectivePriority() > _allThreads[*next]->getEffectivePriority()))
+        {
+            next = it;
+            nextRunnable = runnable;
+        }
+    }
+    Thread* nextThread = _allThreads[*next];
+    _mutexBlockedThreads.erase(next);
+    if (!nextRunnable)
+    {
+        set_state(nextThread, BLOCKED);
+        return nullptr;
+    }
+    wake_thread(nextThread->getId());
+    return nextThread;
+}
+
+/**
+ * Gives the CPU to a best-effort thread that has just become READY if the ready queue policy
+ * ranks it above the running thread. The caller must have the signals blocked.
+ */
+void sync_handler::preempt_for_priority(Thread* woken)
+{
+    if (_idle || woken == _runningThread || woken->getState() != READY ||
+        _schedPolicy == UTHREAD_SCHED_FAIR || woken->hasBudget() || _runningThread->hasBudget())
+    {
+        return;
+    }
+    if (SchedPolicy::preempts(woken, _runningThread))
+    {
+        preempt_running_thread();
+    }
+}
+
+/**
+ * Calls the key destructors on the thread's non-NULL values, as it is being reaped.
+ */
+void sync_handler::run_key_destructors(Thread* thread)
+{
+    for (int key = 0; key < UTHREAD_KEYS_MAX; ++key)
+    {
+        if (!_keyInUse[key] || _keyDestructors[key] == nullptr)
+        {
+            continue;
+        }
+        void* value = thread->getSpecific(key);
+        if (value != nullptr)
+        {
+            thread->setSpecific(key, nullptr);
+            _keyDestructors[key](value);
+        }
+    }
+}
+
+/**
+ * @return the new key, or -1 if all UTHREAD_KEYS_MAX keys are taken.
+ */
+int sync_handler::create_key(void (*destructor)(void*))
+{
+    block_maskedSignals();
+    if (_nextAvailableKey.empty())
+    {
+        unblock_maskedSignals();
+        return FAIL;
+    }
+    int key = _nextAvailableKey.top();
+    _nextAvailableKey.pop();
+    _keyDestructors[key] = destructor;
+    _keyInUse[key] = true;
+    unblock_maskedSignals();
+    return key;
+}
+
+bool sync_handler::is_valid_key(int key)
+{
+    return key >= 0 && key < UTHREAD_KEYS_MAX && _keyInUse[key];
+}
+
+/**
+ * Frees the key and clears every thread's value for it, so a later key reusing the slot starts
+ * out NULL everywhere.
+ */
+void sync_handler::delete_key(int key)
+{
+    block_maskedSignals();
+    for (auto th : _allThreads)
+    {
+        if (th.second->getSpecific(key) != nullptr)
+        {
+            th.second->setSpecific(key, nullptr);
+        }
+    }
+    _keyInUse[key] = false;
+    _keyDestructors[key] = nullptr;
+    _nextAvailableKey.push(key);
+    unblock_maskedSignals();
+}
+
+void* sync_handler::get_specific(int key)
+{
+    return _runningThread->getSpecific(key);
+}
+
+void sync_handler::set_specific(int key, void* value)
+{
+    if (key < UTHREAD_KEYS_INLINE)
+    {
+        _runningThread->setSpecific(key, value);
+        return;
+    }
+    // the overflow area may grow, keep the allocator away from preemption
+    block_maskedSignals();
+    _runningThread->setSpecific(key, value);
+    unblock_maskedSignals();
+}
+
+void* sync_handler::alloc(size_t size)
+{
+    return _runningThread->getArena()->allocate(size);
+}
+
+void* sync_handler::alloc_shared(size_t size)
+{
+    block_maskedSignals();
+    if (_sharedArena == nullptr)
+    {
+        _sharedArena = new(std::nothrow) Arena();
+    }
+    void* block = (_sharedArena == nullptr) ? nullptr : _sharedArena->allocate(size);
+    unblock_maskedSignals();
+    return block;
+}
+
+/**
+ * The owner frees its own blocks directly; a block of another thread's arena is pushed to that
+ * arena's lock-free remote list, the shared arena's included, which is drained on its next
+ * allocation.
+ */
+void sync_handler::free_block(void* ptr)
+{
+    Arena* owner = Arena::ownerOf(ptr);
+    if (owner == _runningThread->getArena())
+    {
+        owner->release(ptr);
+        return;
+    }
+    owner->releaseRemote(ptr);
+}
+
+/**
+ * Blocks the running thread until unpark (or until timeoutUsecs pass, if positive), unless a
+ * permit from an earlier unpark is pending. Checking the permit and blocking happen with the
+ * signals blocked, so no wakeup is lost.
+ */
+void sync_handler::park(long long timeoutUsecs)
+{
+    block_maskedSignals();
+    if (_runningThread->hasParkPermit())
+    {
+        _runningThread->setParkPermit(false);
+        unblock_maskedSignals();
+        return;
+    }
+    _runningThread->setParked(true);
+    if (timeoutUsecs > 0)
+    {
+        block_until(now_usecs() + timeoutUsecs);
+    }
+    else
+    {
+        changeStateToBlocked(_runningThread->getId());
+        block_maskedSignals();
+    }
+    _runningThread->setParked(false);
+    unblock_maskedSignals();
+}
+
+/**
+ * Blocks the running thread until the given time, or until it is resumed or unparked earlier.
+ * The caller must have the signals blocked.
+ */
+void sync_handler::block_until(long long wakeUsecs)
+{
+    _runningThread->setWakeUsecs(wakeUsecs);
+    _sleepingThreads.insert(std::make_pair(wakeUsecs, _runningThread->getId()));
+    changeStateToBlocked(_runningThread->getId());
+    // changeStateToBlocked returns with the signals unblocked, but the sleeping set is shared
+    // with the timer handler
+    block_maskedSignals();
+    if (_runningThread->getWakeUsecs() != 0)
+    {
+        // woken before the timeout
+        _sleepingThreads.erase(std::make_pair(wakeUsecs, _runningThread->getId()));
+        _runningThread->setWakeUsecs(0);
+    }
+}
+
+/**
+ * Blocks the running thread for usecs micro-seconds. An early uthread_resume ends the sleep.
+ */
+void sync_handler::sleep(long long usecs)
+{
+    block_maskedSignals();
+    block_until(now_usecs() + usecs);
+    unblock_maskedSignals();
+}
+
+/**
+ * Wakes the thread if it is parked, otherwise leaves it a permit for its next park.
+ */
+void sync_handler::unpark(int id)
+{
+    block_maskedSignals();
+    Thread* thread = _allThreads[id];
+    if (thread->isParked() && thread->getState() == BLOCKED)
+    {
+        thread->setParked(false);
+        resumeThread(id);
+    }
+    else
+    {
+        thread->setParkPermit(true);
+    }
+    unblock_maskedSignals();
+}
+
+/**
+ * Posts a wakeup for the next scheduling point. Only atomics and write(2), so it is safe from any
+ * kernel thread and from signal handlers.
+ */
+void sync_handler::resume_remote(int id)
+{
+    _remoteWakeups[id / 64].fetch_or(1ULL << (id % 64), std::memory_order_release);
+    if (!_wakeupKicked.load(std::memory_order_relaxed) && !_wakeupKicked.exchange(true))
+    {
+        eventfd_write(_wakeupFd, 1);
+    }
+}
+
+/**
+ * @return the new group's ID, or -1 if all UTHREAD_GROUPS_MAX IDs are taken.
+ */
+int sync_handler::create_group()
+{
+    block_maskedSignals();
+    if (_nextAvailableGroup.empty())
+    {
+        unblock_maskedSignals();
+        return FAIL;
+    }
+    ThreadGroup* group = new(std::nothrow) ThreadGroup(_nextAvailableGroup.top());
+    if (group == nullptr)
+    {
+        exit_and_print_error(CREATE_GROUP_FAIL_MSG);
+    }
+    _nextAvailableGroup.pop();
+    if (!is_tracking_slices())
+    {
+        _sliceStartUsecs = now_usecs();
+    }
+    _groups[group->getId()] = group;
+    _groupCount++;
+    unblock_maskedSignals();
+    return group->getId();
+}
+
+bool sync_handler::is_valid_group(int group)
+{
+    return group >= 0 && group < UTHREAD_GROUPS_MAX && _groups[group] != nullptr;
+}
+
+/**
+ * @return false, keeping the group, if it still has members.
+ */
+bool sync_handler::destroy_group(int group)
+{
+    block_maskedSignals();
+    if (!_groups[group]->getMembers().empty())
+    {
+        unblock_maskedSignals();
+        return false;
+    }
+    delete _groups[group];
+    _groups[group] = nullptr;
+    _groupCount--;
+    _nextAvailableGroup.push(group);
+    unblock_maskedSignals();
+    return true;
+}
+
+void sync_handler::block_group(int group)
+{
+    int ids[MAX_THREAD_NUM];
+    block_maskedSignals();
+    const std::vector<Thread*>& members = _groups[group]->getMembers();
+    int count = (int) members.size();
+    for (int i = 0; i < count; ++i)
+    {
+        ids[i] = members[i]->getId();
+    }
+    // the main thread never joins a group, so the batch is always valid
+    block_many(ids, count);
+    unblock_maskedSignals();
+}
+
+void sync_handler::resume_group(int group)
+{
+    int ids[MAX_THREAD_NUM];
+    block_maskedSignals();
+    const std::vector<Thread*>& members = _groups[group]->getMembers();
+    int count = (int) members.size();
+    for (int i = 0; i < count; ++i)
+    {
+        ids[i] = members[i]->getId();
+    }
+    resume_many(ids, count);
+    unblock_maskedSignals();
+}
+
+/**
+ * Terminates every member in one critical section, taking the READY ones out of the ready queue
+ * in a single pass. A calling member terminates last, so the call does not return then.
+ */
+void sync_handler::terminate_group(int group)
+{
+    Thread* members[MAX_THREAD_NUM];
+    Thread* leaving[MAX_THREAD_NUM];
+    int leavingCount = 0;
+    bool terminatesItself = false;
+
+    block_maskedSignals();
+    const std::vector<Thread*>& groupMembers = _groups[group]->getMembers();
+    int count = (int) groupMembers.size();
+    for (int i = 0; i < count; ++i)
+    {
+        members[i] = groupMembers[i];
+        if (members[i]->getState() == READY)
+        {
+            leaving[leavingCount++] = members[i];
+        }
+    }
+    remove_many_from_readyThreads(leaving, leavingCount);
+
+    for (int i = 0; i < count; ++i)
+    {
+        Thread* thread = members[i];
+        if (thread == _runningThread)
+        {
+            terminatesItself = true;
+            continue;
+        }
+        if (thread->getState() == BLOCKED || thread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+        {
+            _blockedThreads.erase(thread->getId());
+        }
+        detach_thread(thread);
+        delete thread;
+    }
+
+    if (terminatesItself)
+    {
+        terminate_running_thread();
+    }
+    unblock_maskedSignals();
+}
+
+int sync_handler::get_group_quantums(int group)
+{
+    return _groups[group]->getQuantumCount();
+}
+
+/**
+ * Run time is charged when a member leaves the CPU, so a running member's current slice is not
+ * counted yet.
+ */
+long long sync_handler::get_group_cpu_usecs(int group)
+{
+    return _groups[group]->getCpuUsecs();
+}
+
+bool sync_handler::start_profiler(int sample_usecs)
+{
+    block_maskedSignals();
+    set_profile_timer(0);
+    bool started = Profiler::start();
+    if (started)
+    {
+        _profileSampleUsecs = sample_usecs;
+        _profiling = true;
+        set_profile_timer(sample_usecs);
+    }
+    unblock_maskedSignals();
+    return started;
+}
+
+void sync_handler::stop_profiler()
+{
+    block_maskedSignals();
+    set_profile_timer(0);
+    _profiling = false;
+    unblock_maskedSignals();
+}
+
+int sync_handler::dump_profile(int fd)
+{
+    block_maskedSignals();
+    int ret = Profiler::dump(fd);
+    unblock_maskedSignals();
+    return ret;
+}
+
+bool sync_handler::start_lock_profiler()
+{
+    block_maskedSignals();
+    bool started = LockProfiler::start();
+    _lockProfiling = started;
+    unblock_maskedSignals();
+    return started;
+}
+
+void sync_handler::stop_lock_profiler()
+{
+    block_maskedSignals();
+    _lockProfiling = false;
+    unblock_maskedSignals();
+}
+
+int sync_handler::dump_lock_profile(int fd, bool json)
+{
+    block_maskedSignals();
+    int ret = LockProfiler::dump(fd, json);
+    unblock_maskedSignals();
+    return ret;
+}
+
+/**
+ * Arms the SIGPROF timer on the scheduler thread's CPU clock with the given period, or disarms it
+ * when sample_usecs is 0. Like the preemption timer it only signals the kernel thread that
+ * runs the uthreads.
+ */
+void sync_handler::set_profile_timer(int sample_usecs)
+{
+    if (!_profileTimerCreated)
+    {
+        if (sample_usecs == 0)
+        {
+            return;
+        }
+        struct sigaction sa = {};
+        sa.sa_sigaction = &sigprof_handler;
+        sa.sa_flags = SA_RESTART | SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sigaddset(&sa.sa_mask, SIGVTALRM);
+        if (sigaction(SIGPROF, &sa, NULL) < 0)
+        {
+            exit_and_print_error(SIGACTION_ERR_MSG);
+        }
+
+        struct sigevent sev = {};
+        sev.sigev_notify = SIGEV_THREAD_ID;
+        sev.sigev_signo = SIGPROF;
+        sev.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &_profileTimer) < SUCCESS)
+        {
+            exit_and_print_error(TIMER_CREATE_ERR_MSG);
+        }
+        _profileTimerCreated = true;
+    }
+
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = sample_usecs / MICRO_SECONDS;
+    spec.it_value.tv_nsec = (sample_usecs % MICRO_SECONDS) * NANO_SECONDS_IN_MICRO;
+    spec.it_interval = spec.it_value;
+    if (timer_settime(_profileTimer, 0, &spec, NULL) < SUCCESS)
+    {
+        exit_and_print_error(TIMER_SETTIME_ERR_MSG);
+    }
+}
+
+/**
+ * Opens a seqlock write: readers that see seq odd, or changed over their copy, copy again. The
+ * caller must have the signals blocked, so the scheduler is the only writer.
+ */
+void sync_handler::begin_metrics_update()
+{
+    __atomic_store_n(&_metrics->seq, _metrics->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void sync_handler::end_metrics_update()
+{
+    __atomic_store_n(&_metrics->seq, _metrics->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Changes the state of a thread and, while metrics are published, its slot in the segment.
+ */
+void sync_handler::set_state(Thread* thread, int state)
+{
+    thread->setState(state);
+    if (_metrics != nullptr)
+    {
+        publish_metrics(thread);
+    }
+}
+
+/**
+ * Rewrites the counters and the slot of thread, nullptr for none. Called with the signals blocked
+ * whenever a thread changes state, at every switch for the thread that starts running and when
+ * the scheduler goes idle. Every other slot is already up to date, so this is a fixed number of
+ * plain stores into the segment however many threads there are.
+ */
+void sync_handler::publish_metrics(const Thread* thread)
+{
+    begin_metrics_update();
+    if (thread != nullptr)
+    {
+        _metrics->threads[thread->getId()].state = thread->getState();
+        _metrics->threads[thread->getId()].quantums = thread->getQuantumCount();
+    }
+    _metrics->running_tid = _idle ? UTHREAD_METRICS_IDLE : _runningThread->getId();
+    _metrics->total_quantums = _totalQuantumCount;
+    _metrics->ready_depth = (int32_t) (_readyThreads.size() + _fairReadyThreads.size() +
+                                       _deadlineReadyThreads.size() + (_runNextThread != nullptr));
+    _metrics->mutex_owner = _mutexThreadId;
+    _metrics->mutex_waiters = (int32_t) _mutexBlockedThreads.size();
+    end_metrics_update();
+}
+
+int sync_handler::publish_metrics_to(const char* name)
+{
+    std::string segmentName = (name != nullptr) ? std::string(name) :
+                              METRICS_DEFAULT_NAME + std::to_string(getpid());
+    int fd = shm_open(segmentName.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < SUCCESS)
+    {
+        return FAIL;
+    }
+    void* segment = MAP_FAILED;
+    if (ftruncate(fd, sizeof(uthread_metrics)) == SUCCESS)
+    {
+        segment = mmap(nullptr, sizeof(uthread_metrics), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        shm_unlink(segmentName.c_str());
+        return FAIL;
+    }
+
+    block_maskedSignals();
+    if (_metrics != nullptr && _metricsName == segmentName)
+    {
+        // the same segment mapped twice, the old mapping just goes
+        munmap(_metrics, sizeof(uthread_metrics));
+        _metrics = nullptr;
+    }
+    unmap_metrics();
+    uthread_metrics* metrics = (uthread_metrics*) segment;
+    memset(metrics, 0, sizeof(uthread_metrics));
+    for (int id = 0; id < MAX_THREAD_NUM; ++id)
+    {
+        metrics->threads[id].state = UTHREAD_METRICS_FREE;
+    }
+    for (auto& entry : _allThreads)
+    {
+        metrics->threads[entry.first].state = entry.second->getState();
+        metrics->threads[entry.first].quantums = entry.second->getQuantumCount();
+    }
+    metrics->size = sizeof(uthread_metrics);
+    metrics->max_threads = MAX_THREAD_NUM;
+    metrics->pid = getpid();
+    metrics->quantum_usecs = _quantumSecs;
+    metrics->version = UTHREAD_METRICS_VERSION;
+    // a reader checks the magic first, so it goes in last
+    __atomic_store_n(&metrics->magic, UTHREAD_METRICS_MAGIC, __ATOMIC_RELEASE);
+    _metrics = metrics;
+    _metricsName = segmentName;
+    publish_metrics(nullptr);
+    unblock_maskedSignals();
+    return SUCCESS;
+}
+
+void sync_handler::unpublish_metrics()
+{
+    block_maskedSignals();
+    unmap_metrics();
+    unblock_maskedSignals();
+}
+
+/**
+ * The caller must have the signals blocked.
+ */
+void sync_handler::unmap_metrics()
+{
+    if (_metrics == nullptr)
+    {
+        return;
+    }
+    munmap(_metrics, sizeof(uthread_metrics));
+    shm_unlink(_metricsName.c_str());
+    _metrics = nullptr;
+}
+
+bool sync_handler::is_simulated()
+{
+    return _timerBackend == UTHREAD_TIMER_SIMULATED;
+}
+
+/**
+ * Arms the virtual slice end from _timer. A slice moves by up to _simJitterPercent of its length
+ * either way, drawn from the seeded generator. While a replay is followed the recorded
+ * preemptions end the slices instead, and a recorded switch leaves the slice untimed.
+ */
+void sync_handler::set_simulated_slice()
+{
+    if (!_simReplayDiverged && _simReplayNext < _simReplay.size())
+    {
+        const SimDecision& next = _simReplay[_simReplayNext];
+        _simSliceEndUsecs = (next.reason == SIM_PREEMPTED) ? next.usecs : 0;
+        return;
+    }
+
+    long long slice = _timer.it_value.tv_sec * (long long) MICRO_SECONDS + _timer.it_value.tv_usec;
+    if (slice == RESET_TIMER)
+    {
+        _simSliceEndUsecs = 0;
+        return;
+    }
+    if (_simJitterPercent > 0)
+    {
+        _simRandom = _simRandom * 6364136223846793005ULL + 1442695040888963407ULL;
+        long long spread = slice * _simJitterPercent / 100;
+        slice += (long long) ((_simRandom >> 33) % (unsigned long long) (2 * spread + 1)) - spread;
+    }
+    _simSliceEndUsecs = _simNowUsecs + ((slice > 0) ? slice : 1);
+}
+
+/**
+ * Takes the next thread to run in a simulation: the recorded one while a replay is followed,
+ * otherwise the ready queue's choice. The decision is written out when recording.
+ */
+Thread* sync_handler::sim_pick_next_thread()
+{
+    char reason = _simPreempting ? SIM_PREEMPTED : SIM_SWITCHED;
+    _simPreempting = false;
+
+    Thread* thread = nullptr;
+    if (!_simReplayDiverged && _simReplayNext < _simReplay.size())
+    {
+        const SimDecision& decision = _simReplay[_simReplayNext];
+        Thread* recorded = get_thread_by_id(decision.tid);
+        if (decision.usecs == _simNowUsecs && decision.reason == reason && recorded != nullptr &&
+            recorded->getState() == READY)
+        {
+            remove_from_readyThreads(recorded);
+            thread = recorded;
+            _simReplayNext++;
+        }
+        else
+        {
+            std::cerr << THREAD_LIBRARY_ERROR << SIM_REPLAY_DIVERGED_MSG << _simReplayNext
+                      << std::endl;
+            _simReplayDiverged = true;
+        }
+    }
+    if (thread == nullptr)
+    {
+        thread = pop_from_readyThreads();
+    }
+
+    if (_simRecordFd != FAIL)
+    {
+        dprintf(_simRecordFd, "%lld %d %c\n", _simNowUsecs, thread->getId(), reason);
+    }
+    return thread;
+}
+
+void sync_handler::sim_seed(unsigned int seed, int jitter_percent)
+{
+    block_maskedSignals();
+    _simSeed = seed;
+    _simRandom = seed;
+    _simJitterPercent = jitter_percent;
+    unblock_maskedSignals();
+}
+
+void sync_handler::sim_tick(int usecs)
+{
+    block_maskedSignals();
+    _simNowUsecs += usecs;
+    if (_simSliceEndUsecs != 0 && _simNowUsecs >= _simSliceEndUsecs)
+    {
+        _simSliceEndUsecs = 0;
+        _simPreempting = true;
+        // the same path a timer signal takes, returns once the thread is scheduled again
+        preempt_running_thread();
+    }
+    unblock_maskedSignals();
+}
+
+long long sync_handler::sim_now_usecs()
+{
+    return _simNowUsecs;
+}
+
+int sync_handler::sim_record(int fd)
+{
+    block_maskedSignals();
+    int ret = FAIL;
+    if (dprintf(fd, "seed %u %d\n", _simSeed, _simJitterPercent) >= 0)
+    {
+        _simRecordFd = fd;
+        ret = SUCCESS;
+    }
+    unblock_maskedSignals();
+    return ret;
+}
+
+/**
+ * The recorded seed is restored too, so a run that leaves the schedule goes on as the recorded
+ * run would have.
+ */
+int sync_handler::sim_replay(int fd)
+{
+    int copy = dup(fd);
+    FILE* file = (copy < SUCCESS) ? nullptr : fdopen(copy, "r");
+    if (file == nullptr)
+    {
+        if (copy >= SUCCESS)
+        {
+            close(copy);
+        }
+        return FAIL;
+    }
+    unsigned int seed;
+    int jitterPercent;
+    std::vector<SimDecision> schedule;
+    bool ok = (fscanf(file, " seed %u %d", &seed, &jitterPercent) == 2);
+    SimDecision decision;
+    while (ok && fscanf(file, " %lld %d %c", &decision.usecs, &decision.tid, &decision.reason) == 3)
+    {
+        ok = (decision.reason == SIM_PREEMPTED || decision.reason == SIM_SWITCHED);
+        schedule.push_back(decision);
+    }
+    ok = ok && feof(file);
+    fclose(file);
+    if (!ok)
+    {
+        return FAIL;
+    }
+
+    block_maskedSignals();
+    _simSeed = seed;
+    _simRandom = seed;
+    _simJitterPercent = jitterPercent;
+    _simReplay.swap(schedule);
+    _simReplayNext = 0;
+    _simReplayDiverged = false;
+    // the running slice ends where the recording says too
+    set_simulated_slice();
+    unblock_maskedSignals();
+    return SUCCESS;
+}
+
+int sync_handler::sim_replay_status()
+{
+    if (_simReplayDiverged)
+    {
+        return FAIL;
+    }
+    return (_simReplayNext < _simReplay.size()) ? 1 : SUCCESS;
+}
@@ -1,167 +1,772 @@
-#include <signal.h>
-#include <queue>
-#include <unordered_map>
-#include "uthreads.h"
-#include "Thread.h"
-#include <sys/time.h>
-#include <setjmp.h>
-
-#ifndef EX2_OS_SYNC_HANDLER_H
-#define EX2_OS_SYNC_HANDLER_H
-#define SUCCESS 0
-#define FAIL -1
-#define UNLOCKED -1
-#define THREAD_LIBRARY_ERROR "thread library error: "
-#define SYSTEM_ERROR "system error: "
-#define MICRO_SECONDS 1000000
-#define RESET_TIMER 0
-#define RETURN_VALUE_FROM_JMP 1
-#define UNLOCK_FAIL_MSG "Unlocking the mutex failed."
-#define LOCK_FAIL_MSG "Locking the mutex failed."
-#define SETITIMER_ERR_MSG "setitimer error."
-#define SIGACTION_ERR_MSG "sigaction error."
-#define SIGADDSET_FAIL_MSG "sigaddset failed to add signal to the set."
-#define SIGEMPTYSET_FAIL_MSG "sigemptyset failed to clear the set."
-#define SIGPROCMASK_BLOCK_FAIL_MSG "sigprocmask failed to block the set."
-#define SIGPROCMASK_UNBLOCK_FAIL_MSG "sigprocmask failed to unblock the set."
-
-#define CREATE_THREAD_FAIL_MSG "Allocating a new thread failed."
-
-#define INIT_MUTEX_ERR "Initializing the mutex failed."
-
-
-
-
-class sync_handler
-{
-private:
-    /**
-     * counter for all the quantoms in the process
-     */
-    static int _totalQuantumCount;
-
-    /**
-     *A pointer to the current running thread.
-     */
-    static Thread* _runningThread;
-
-    /**
-     * the id of the thread that is currently locking the mutex. Will be -1 when unlocked
-     */
-    static int _mutexThreadId;
-
-    /**
-     * A queue of threads in 'READY' status
-     */
-    static std::deque<int> _readyThreads;
-
-    /**
-     * A mapping between threadID and the thread pointer - for all threads.
-     */
-    static std::unordered_map<int, Thread*> _allThreads;
-
-    /**
-    * A mapping between threadID and the thread pointer - for the blocked threads.
-    */
-    static std::unordered_map<int, Thread*> _blockedThreads;
-
-    /**
-     * A queue of threads in 'MUTEX_BLOCKED' status
-     */
-    static std::deque<int> _mutexBlockedThreads;
-
-    /**
-    * A set containing the signals to be blocked
-    */
-    static sigset_t _maskedSignals;
-
-    /**
-     * A priority queue (min heap) that keeps the next smallest available Id.
-     */
-    static std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> _nextAvailableID;
-
-    /**
-     * Sigaction struct - to define handlers.
-     * */
-    static struct sigaction _sa;
-
-    /**
-     * The timer used.
-     * */
-    static struct itimerval _timer;
-
-    /**
-     * The size of a quantum in ms (as received in the init method).
-     */
-    static int _quantumSecs;
-
-    static pthread_mutex_t _mutex;
-
-    /**
-     * set the masking set and check system calls
-     * @return
-     */
-    static void init_maskedSignals();
-
-    static void init_timer();
-
-    static void set_interval_timer();
-
-    static void set_timer();
-
-    static void reset_timer();
-
-    static void init_mutex();
-
-    static void sigvtalrm_handler(int);
-
-    static void changeStateToReady(int id);
-
-    static void changeStateToRunning();
-
-    static void block_maskedSignals();
-
-    static void unblock_maskedSignals();
-
-    static Thread* create_main_thread();
-
-    static void remove_from_readyThreads(Thread* threadToRemove);
-
-public:
-
-    static int create_new_thread(void (*f)(void));
-
-    static void init_sync_handler(int quantum_usecs);
-
-    static bool can_add_new_thread();
-
-    static Thread* get_thread_by_id(int id);
-
-    static void release_resources_by_thread(int id);
-
-    static void release_all_resources();
-
-    static void changeStateToBlocked(int id);
-
-    static void resumeThread(int id);
-
-    static int get_running_thread_id();
-
-    static int get_mutex_thread_id();
-
-    static int get_total_quantums();
-
-    static int get_quantums_by_id(int id);
-
-    static int lock_mutex();
-
-    static int unlock_mutex();
-
-    static void exit_and_print_error(std::string msg);
-
-    static int return_and_print_error(std::string msg);
-
-};
-
-
-#endif //EX2_OS_SYNC_HANDLER_H
+#include <signal.h>
+#include <atomic>
+#include <queue>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include "uthreads.h"
+#include "Thread.h"
+#include "ThreadGroup.h"
+#include "SchedPolicy.h"
+#include "Profiler.h"
+#include "LockProfiler.h"
+#include "uthread_metrics.h"
+#include <sys/time.h>
+#include <time.h>
+#include <poll.h>
+#include <setjmp.h>
+
+#ifndef EX2_OS_SYNC_HANDLER_H
+#define EX2_OS_SYNC_HANDLER_H
+#define SUCCESS 0
+#define FAIL -1
+#define UNLOCKED -1
+#define THREAD_LIBRARY_ERROR "thread library error: "
+#define SYSTEM_ERROR "system error: "
+#define MICRO_SECONDS 1000000
+#define NANO_SECONDS_IN_MICRO 1000
+#define RESET_TIMER 0
+#define RETURN_VALUE_FROM_JMP 1
+#define UNLOCK_FAIL_MSG "Unlocking the mutex failed."
+#define LOCK_FAIL_MSG "Locking the mutex failed."
+#define SETITIMER_ERR_MSG "setitimer error."
+#define TIMER_CREATE_ERR_MSG "timer_create error."
+#define TIMER_SETTIME_ERR_MSG "timer_settime error."
+#define SIGACTION_ERR_MSG "sigaction error."
+#define SIM_REPLAY_DIVERGED_MSG "the simulation left the replayed schedule at decision "
+#define SIGADDSET_FAIL_MSG "sigaddset failed to add signal to the set."
+#define SIGEMPTYSET_FAIL_MSG "sigemptyset failed to clear the set."
+#define SIGPROCMASK_BLOCK_FAIL_MSG "sigprocmask failed to block the set."
+#define SIGPROCMASK_UNBLOCK_FAIL_MSG "sigprocmask failed to unblock the set."
+#define PPOLL_ERR_MSG "ppoll failed while idle."
+#define EVENTFD_ERR_MSG "eventfd error."
+#define METRICS_DEFAULT_NAME "/uthreads." /* followed by the pid */
+
+#define CREATE_THREAD_FAIL_MSG "Allocating a new thread failed."
+#define CREATE_GROUP_FAIL_MSG "Allocating a new thread group failed."
+
+#define INIT_MUTEX_ERR "Initializing the mutex failed."
+
+#define DEADLINE_UTILIZATION_LIMIT 900000 /* parts per million of the CPU the deadline class may reserve */
+#define REMOTE_WAKEUP_WORDS ((MAX_THREAD_NUM + 63) / 64) /* 64-bit words of pending remote wakeups */
+#define SIM_EPOCH_USECS MICRO_SECONDS /* where the virtual clock starts, 0 means "no time" to Thread */
+#define SIM_PREEMPTED 'P' /* a recorded decision taken because the slice ended */
+#define SIM_SWITCHED 'S' /* a recorded decision taken because the thread gave up the CPU */
+
+
+
+
+/**
+ * One scheduling decision of a simulation: at virtual time usecs thread tid got the CPU, either
+ * because the previous slice ended (SIM_PREEMPTED) or because its thread gave up the CPU.
+ */
+struct SimDecision
+{
+    long long usecs;
+    int tid;
+    char reason;
+};
+
+/**
+ * A reclamation deferred with uthread_call_rcu.
+ */
+struct RcuCallback
+{
+    void (*fn)(void*);
+    void* ptr;
+};
+
+class sync_handler
+{
+private:
+    /**
+     * counter for all the quantoms in the process
+     */
+    static int _totalQuantumCount;
+
+    /**
+     *A pointer to the current running thread.
+     */
+    static Thread* _runningThread;
+
+    /**
+     * the id of the thread that is currently locking the mutex. Will be -1 when unlocked
+     */
+    static int _mutexThreadId;
+
+    /**
+     * The best-effort threads in 'READY' status, ordered by the policy compiled in.
+     */
+    static SchedPolicy _readyThreads;
+
+    /**
+     * The ready threads under UTHREAD_SCHED_FAIR, ordered by (virtual runtime, id).
+     */
+    static std::set<std::pair<unsigned long long, int>> _fairReadyThreads;
+
+    /**
+     * The scheduling policy in use (one of the UTHREAD_SCHED_* values).
+     */
+    static int _schedPolicy;
+
+    /**
+     * Lower bound for the virtual runtime of threads entering the fair ready queue, so a new or
+     * long-blocked thread cannot monopolize the CPU while it catches up.
+     */
+    static unsigned long long _minVruntime;
+
+    /**
+     * The ready deadline threads whose current job has budget left, ordered by (deadline, id).
+     * They always run before the best-effort queue.
+     */
+    static std::set<std::pair<long long, int>> _deadlineReadyThreads;
+
+    /**
+     * IDs of all the threads in the deadline class.
+     */
+    static std::set<int> _deadlineThreads;
+
+    /**
+     * Sum of budget / period over the deadline class, in parts per million.
+     */
+    static long long _deadlineUtilization;
+
+    /**
+     * A priority queue (min heap) that keeps the next smallest free uthread-local storage key.
+     */
+    static std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> _nextAvailableKey;
+
+    /**
+     * Destructor of every uthread-local storage key (nullptr when it has none), by key.
+     */
+    static void (*_keyDestructors[UTHREAD_KEYS_MAX])(void*);
+
+    /**
+     * Which keys are currently allocated.
+     */
+    static bool _keyInUse[UTHREAD_KEYS_MAX];
+
+    /**
+     * Threads sleeping or parked with a timeout, ordered by (wake-up time, id).
+     */
+    static std::set<std::pair<long long, int>> _sleepingThreads;
+
+    /**
+     * THROTTLED threads, ordered by (end of their quota period, id), and the number of threads
+     * with a CPU quota.
+     */
+    static std::set<std::pair<long long, int>> _throttledThreads;
+    static int _quotaThreadCount;
+
+    /**
+     * The thread groups by group ID, nullptr for a free ID.
+     */
+    static ThreadGroup* _groups[UTHREAD_GROUPS_MAX];
+
+    /**
+     * A priority queue (min heap) that keeps the next smallest free group ID.
+     */
+    static std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> _nextAvailableGroup;
+
+    static int _groupCount;
+
+    /**
+     * A thread that terminated itself. Its stack is in use until the switch away from it, so it
+     * is deleted at the next scheduling decision.
+     */
+    static Thread* _zombieThread;
+
+    /**
+     * The thread the next switch goes to, bypassing the ready queues, and whether it keeps the
+     * timer running so it gets the rest of the current slice. Set by a directed handoff.
+     */
+    static Thread* _handoffThread;
+    static bool _donatingSlice;
+
+    /**
+     * Whether threads woken by the running thread go to the run-next slot, the thread in it
+     * (nullptr when empty), and when the current run of slot picks started (0 when the last
+     * pick came from the ready queues). The slot is a READY thread that runs before the
+     * best-effort queue, as long as the picks from it stay within one quantum.
+     */
+    static bool _runNextEnabled;
+    static Thread* _runNextThread;
+    static long long _runNextStreakStartUsecs;
+
+    /**
+     * RCU callbacks retired since the current grace period started, the ones waiting for it, and
+     * the ones whose grace period is over but that did not run yet.
+     */
+    static std::vector<RcuCallback> _rcuNext;
+    static std::vector<RcuCallback> _rcuCurrent;
+    static std::vector<RcuCallback> _rcuDone;
+
+    /**
+     * Whether a grace period is in progress, the threads it still waits for (those that were in
+     * a read-side critical section when it started) and how many of them there are.
+     */
+    static bool _rcuGracePeriod;
+    static bool _rcuWaiting[MAX_THREAD_NUM];
+    static int _rcuWaitingCount;
+
+    /**
+     * Grace periods started and completed so far, and whether one must follow the current one
+     * even if no callback was retired meanwhile.
+     */
+    static long long _rcuStarted;
+    static long long _rcuCompleted;
+    static bool _rcuNextRequested;
+
+    /**
+     * Threads blocked in uthread_synchronize_rcu: (grace period they wait for, id).
+     */
+    static std::vector<std::pair<long long, int>> _rcuSynchronizers;
+
+    /**
+     * Whether new threads get their stacks painted for the stack profiler.
+     */
+    static bool _stackProfiling;
+
+    /**
+     * Per entry function of the profiled threads: (peak stack usage in bytes over the ones that
+     * terminated, number of them spawned, live ones included).
+     */
+    static std::map<ThreadEntry, std::pair<size_t, int>> _entryStackPeaks;
+
+    /**
+     * A mapping between threadID and the thread pointer - for all threads.
+     */
+    static std::unordered_map<int, Thread*> _allThreads;
+
+    /**
+    * A mapping between threadID and the thread pointer - for the blocked threads.
+    */
+    static std::unordered_map<int, Thread*> _blockedThreads;
+
+    /**
+     * A queue of threads in 'MUTEX_BLOCKED' status
+     */
+    static std::deque<int> _mutexBlockedThreads;
+
+    /**
+    * A set containing the signals to be blocked
+    */
+    static sigset_t _maskedSignals;
+
+    /**
+     * A priority queue (min heap) that keeps the next smallest available Id.
+     */
+    static std::priority_queue<u_int, std::vector<u_int>, std::greater<u_int>> _nextAvailableID;
+
+    /**
+     * Sigaction struct - to define handlers.
+     * */
+    static struct sigaction _sa;
+
+    /**
+     * The timer used.
+     * */
+    static struct itimerval _timer;
+
+    /**
+     * The preemption clock chosen at init (one of the UTHREAD_TIMER_* values).
+     */
+    static int _timerBackend;
+
+    /**
+     * Whether the sampling profiler runs, and its sampling period in micro-seconds of the
+     * scheduler thread's CPU time (0 to sample at every preemption tick instead).
+     */
+    static bool _profiling;
+    static int _profileSampleUsecs;
+
+    /**
+     * The POSIX timer that delivers SIGPROF for the sampling profiler, created on first use.
+     */
+    static timer_t _profileTimer;
+    static bool _profileTimerCreated;
+
+    /**
+     * Whether the mutex contention profiler records acquires and releases.
+     */
+    static bool _lockProfiling;
+
+    /**
+     * The arena of uthread_alloc_shared, which no thread owns and which outlives them all; it is
+     * created on first use and only touched with the signals blocked.
+     */
+    static Arena* _sharedArena;
+
+    /**
+     * The shared-memory segment the scheduler publishes its counters to, nullptr when not
+     * publishing, and the name it was created under.
+     */
+    static uthread_metrics* _metrics;
+    static std::string _metricsName;
+
+    /**
+     * The virtual clock of UTHREAD_TIMER_SIMULATED, in micro-seconds, and when the running
+     * thread's slice ends on it (0 while no slice is timed).
+     */
+    static long long _simNowUsecs;
+    static long long _simSliceEndUsecs;
+
+    /**
+     * The seed the slice jitter generator started from, its state, and how far (in percent of
+     * the slice) the jitter may move a slice end.
+     */
+    static unsigned int _simSeed;
+    static unsigned long long _simRandom;
+    static int _simJitterPercent;
+
+    /**
+     * Set while a slice end preempts the running thread, so the decision is recorded as
+     * SIM_PREEMPTED. Preemptions by a woken thread count as switches: no slice end leads to them.
+     */
+    static bool _simPreempting;
+
+    /**
+     * Where every decision is written, -1 when not recording.
+     */
+    static int _simRecordFd;
+
+    /**
+     * The schedule being replayed and the next decision to take from it. The replay stops at the
+     * first decision the run cannot follow.
+     */
+    static std::vector<SimDecision> _simReplay;
+    static size_t _simReplayNext;
+    static bool _simReplayDiverged;
+
+    /**
+     * The POSIX timer used by the UTHREAD_TIMER_MONOTONIC and UTHREAD_TIMER_THREAD_CPU backends.
+     */
+    static timer_t _posixTimer;
+
+    /**
+     * True while no thread is READY and the scheduler waits in idle_until_ready().
+     */
+    static bool _idle;
+
+    /**
+     * Threads woken by uthread_resume_remote and not handled yet, one bit per thread ID. Other
+     * kernel threads and signal handlers only set bits; the scheduler takes a whole word at once.
+     */
+    static std::atomic<unsigned long long> _remoteWakeups[REMOTE_WAKEUP_WORDS];
+
+    /**
+     * An eventfd polled by idle_until_ready(), so a remote wakeup ends the idle wait.
+     */
+    static int _wakeupFd;
+
+    /**
+     * True once the eventfd was written and not read back yet, so a burst of remote wakeups
+     * costs one write.
+     */
+    static std::atomic<bool> _wakeupKicked;
+
+    /**
+     * The size of a quantum in ms (as received in the init method).
+     */
+    static int _quantumSecs;
+
+    static pthread_mutex_t _mutex;
+
+    /**
+     * True when the quantum is sized per thread from its recent behavior.
+     */
+    static bool _adaptiveQuantum;
+
+    /**
+     * Bounds (in micro-seconds) on the quantum chosen in adaptive mode.
+     */
+    static int _minQuantumUsecs;
+
+    static int _maxQuantumUsecs;
+
+    /**
+     * Number of latency-sensitive threads currently in the ready queue.
+     */
+    static int _latencySensitiveReady;
+
+    /**
+     * When the running thread's slice started (CLOCK_MONOTONIC, micro-seconds). Only kept in
+     * adaptive mode.
+     */
+    static long long _sliceStartUsecs;
+
+    /**
+     * set the masking set and check system calls
+     * @return
+     */
+    static void init_maskedSignals();
+
+    static void init_timer();
+
+    static void init_posix_timer(clockid_t clock);
+
+    static void set_interval_timer();
+
+    static void set_timer();
+
+    static void reset_timer();
+
+    static void init_mutex();
+
+    static void sigvtalrm_handler(int, siginfo_t*, void* context);
+
+    static void sigprof_handler(int, siginfo_t*, void* context);
+
+    static void set_profile_timer(int sample_usecs);
+
+    static void changeStateToReady(int id);
+
+    static void wake_thread(int id);
+
+    static bool can_run_next();
+
+    static void flush_run_next();
+
+    static void changeStateToRunning();
+
+    static void block_maskedSignals();
+
+    static void unblock_maskedSignals();
+
+    static Thread* create_main_thread();
+
+    static void remove_from_readyThreads(Thread* threadToRemove);
+
+    static void push_to_readyThreads(Thread* thread);
+
+    static void profile_new_stack(Thread* thread);
+
+    static void refresh_mutex_boost();
+
+    static void set_inherited_priority(Thread* thread, int priority);
+
+    static Thread* release_mutex();
+
+    static void preempt_for_priority(Thread* woken);
+
+    static void switch_to(Thread* target, bool donateSlice);
+
+    static void record_stack_peak(Thread* thread);
+
+    static void push_preempted_to_readyThreads(Thread* thread);
+
+    static long long now_usecs();
+
+    static void begin_metrics_update();
+
+    static void end_metrics_update();
+
+    static void set_state(Thread* thread, int state);
+
+    static void publish_metrics(const Thread* thread);
+
+    static void unmap_metrics();
+
+    static void set_simulated_slice();
+
+    static Thread* sim_pick_next_thread();
+
+    static void push_many_to_readyThreads(Thread** threads, int count);
+
+    static void remove_many_from_readyThreads(Thread** threads, int count);
+
+    static Thread* pop_from_readyThreads();
+
+    static void end_slice(bool exhaustedQuantum);
+
+    static int choose_quantum(Thread* thread);
+
+    static bool is_tracking_slices();
+
+    static void preempt_running_thread();
+
+    static void preempt_for_deadline(Thread* woken);
+
+    static void release_deadline_threads();
+
+    static int bound_quantum_by_deadlines(int quantum);
+
+    static long long utilization_of(Thread* thread);
+
+    static long long next_release_usecs();
+
+    static long long next_wakeup_usecs();
+
+    static void release_sleeping_threads();
+
+    static void release_remote_threads();
+
+    static bool throttle_if_over_quota(Thread* thread);
+
+    static void unthrottle(Thread* thread);
+
+    static void release_throttled_threads();
+
+    static void start_grace_period();
+
+    static void end_grace_period();
+
+    static void rcu_quiescent(Thread* thread);
+
+    static void forget_rcu_thread(int id);
+
+    static void run_rcu_callbacks();
+
+    static void wait_for_grace_period();
+
+    static void release_woken_threads();
+
+    static void block_until(long long wakeUsecs);
+
+    static bool has_ready_threads();
+
+    static void idle_until_ready();
+
+    static void run_key_destructors(Thread* thread);
+
+    static void detach_thread(Thread* thread);
+
+    static void reap_zombie_thread();
+
+public:
+
+    static int create_new_thread(void (*f)(void), int group);
+
+    static void init_sync_handler(int quantum_usecs, int timer_backend);
+
+    static int create_many_threads(void (*const fns[])(void), int count, int tids[]);
+
+    static bool can_add_new_thread();
+
+    static bool can_add_new_threads(int count);
+
+    static Thread* get_thread_by_id(int id);
+
+    static void release_resources_by_thread(int id);
+
+    static void release_all_resources();
+
+    static void terminate_running_thread();
+
+    static void changeStateToBlocked(int id);
+
+    static void resumeThread(int id);
+
+    static bool block_many(const int ids[], int count);
+
+    /**
+     * Gives the CPU straight to a READY thread; does nothing if the thread is not READY.
+     */
+    static void yield_to(int id, bool donateSlice);
+
+    /**
+     * Resumes a blocked thread and gives it the CPU in the same critical section.
+     */
+    static void resume_and_switch(int id, bool donateSlice);
+
+    static bool resume_many(const int ids[], int count);
+
+    static int get_running_thread_id();
+
+    static int get_mutex_thread_id();
+
+    static int get_total_quantums();
+
+    static int get_quantums_by_id(int id);
+
+    static void set_adaptive_quantum(int min_usecs, int max_usecs);
+
+    static int get_quantum_usecs_by_id(int id);
+
+    static void set_sched_policy(int policy);
+
+    static void set_weight(int id, int weight);
+
+    static void set_priority(int id, int priority);
+
+    static void set_run_next(bool enable);
+
+    static int get_boost_count(int id);
+
+    static long long get_boosted_usecs(int id);
+
+    static void set_cpu_quota(int id, int quota_usecs, int period_usecs);
+
+    static int get_throttle_count(int id);
+
+    static long long get_throttled_usecs(int id);
+
+    static bool can_admit_deadline(int id, int period_usecs, int budget_usecs);
+
+    static void set_deadline(int id, int period_usecs, int budget_usecs);
+
+    static void wait_next_period();
+
+    static int get_deadline_misses_by_id(int id);
+
+    static int create_key(void (*destructor)(void*));
+
+    static bool is_valid_key(int key);
+
+    static void delete_key(int key);
+
+    static void* get_specific(int key);
+
+    static void set_specific(int key, void* value);
+
+    static void* alloc(size_t size);
+
+    static void* alloc_shared(size_t size);
+
+    static void free_block(void* ptr);
+
+    static void park(long long timeoutUsecs);
+
+    static void sleep(long long usecs);
+
+    static void unpark(int id);
+
+    static void resume_remote(int id);
+
+    static int create_group();
+
+    static bool is_valid_group(int group);
+
+    static bool destroy_group(int group);
+
+    static void block_group(int group);
+
+    static void resume_group(int group);
+
+    static void terminate_group(int group);
+
+    static int get_group_quantums(int group);
+
+    static long long get_group_cpu_usecs(int group);
+
+    static void set_stack_profiling(bool enable);
+
+    /**
+     * @return the peak stack usage of the thread in bytes, -1 if it does not exist or its stack
+     * is not profiled.
+     */
+    static int get_stack_peak(int id);
+
+    /**
+     * @return the peak stack usage over the profiled threads spawned with f, live or terminated,
+     * -1 if there were none.
+     */
+    static int get_entry_stack_peak(ThreadEntry f);
+
+    static int dump_stack_profile(int fd);
+
+    /**
+     * Starts the sampling profiler over, sampling every sample_usecs of CPU time, or at every
+     * preemption tick when it is 0.
+     * @return false if the sample buffer could not be allocated.
+     */
+    static bool start_profiler(int sample_usecs);
+
+    static void stop_profiler();
+
+    static int dump_profile(int fd);
+
+    /**
+     * Starts the mutex contention profiler over.
+     * @return false if its site table could not be allocated.
+     */
+    static bool start_lock_profiler();
+
+    static void stop_lock_profiler();
+
+    static int dump_lock_profile(int fd, bool json);
+
+    /**
+     * Creates the shared-memory segment name (METRICS_DEFAULT_NAME and the pid when nullptr) and
+     * publishes to it from now on, replacing the segment published before.
+     * @return -1 if the segment could not be created.
+     */
+    static int publish_metrics_to(const char* name);
+
+    /**
+     * Stops publishing and removes the segment.
+     */
+    static void unpublish_metrics();
+
+    static bool is_simulated();
+
+    static void sim_seed(unsigned int seed, int jitter_percent);
+
+    /**
+     * Moves the virtual clock usecs on and preempts the running thread if its slice ended.
+     */
+    static void sim_tick(int usecs);
+
+    static long long sim_now_usecs();
+
+    /**
+     * Writes the seed, then every scheduling decision from now on, to fd.
+     * @return -1 if writing failed.
+     */
+    static int sim_record(int fd);
+
+    /**
+     * Reads a recorded schedule from fd and makes the following decisions follow it.
+     * @return -1 if fd does not hold a schedule.
+     */
+    static int sim_replay(int fd);
+
+    /**
+     * @return 1 while a replay is being followed, 0 once it was followed to its end (or none was
+     * loaded), -1 if the run left it.
+     */
+    static int sim_replay_status();
+
+    static void rcu_read_lock();
+
+    /**
+     * Leaving the outermost section runs the callbacks whose grace period is over.
+     * @return false if the running thread is not in a read-side critical section.
+     */
+    static bool rcu_read_unlock();
+
+    static bool in_rcu_read_section();
+
+    /**
+     * Retires ptr to fn, then runs the callbacks whose grace period is over.
+     */
+    static void call_rcu(void (*fn)(void*), void* ptr);
+
+    /**
+     * Blocks until a grace period that starts after the call is over, then runs the callbacks
+     * whose grace period is over. The running thread must not be in a read-side critical section.
+     */
+    static void synchronize_rcu();
+
+    /**
+     * Blocks until every callback retired before the call has run, then runs the callbacks whose
+     * grace period is over. The running thread must not be in a read-side critical section.
+     */
+    static void rcu_barrier();
+
+    /**
+     * @param caller the return address of uthread_mutex_lock, the call site the contention
+     * profiler charges the acquire to.
+     */
+    static int lock_mutex(void* caller);
+
+    static int unlock_mutex();
+
+    static void exit_and_print_error(std::string msg);
+
+    static int return_and_print_error(std::string msg);
+
+};
+
+
+#endif //EX2_OS_SYNC_HANDLER_H
@@ -0,0 +1,56 @@
+/*
+ * Regression test: tasks spawned by a thread that terminates before they finish must still run
+ * to completion, their frames outliving the spawner's arena.
+ * Exits with 0 when every task finished, 1 otherwise.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "uthreads.h"
+#include "uthread_task.h"
+
+#define SPAWNERS 2
+#define TASKS_PER_SPAWNER 8
+#define TASK_SLEEP_USECS 20000
+#define WAIT_STEP_USECS 1000
+#define WAIT_STEPS 1000
+
+static int finished;
+
+static uthread::task<void> job()
+{
+    co_await uthread::sleep_for(TASK_SLEEP_USECS);
+    finished++;
+}
+
+static void spawner()
+{
+    for (int i = 0; i < TASKS_PER_SPAWNER; ++i)
+    {
+        uthread::co_spawn(job());
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    if (uthread_init_with_timer(1000, UTHREAD_TIMER_MONOTONIC) != 0)
+    {
+        return 1;
+    }
+    for (int i = 0; i < SPAWNERS; ++i)
+    {
+        uthread_spawn(spawner);
+    }
+    for (int step = 0; step < WAIT_STEPS && finished < SPAWNERS * TASKS_PER_SPAWNER; ++step)
+    {
+        uthread_sleep(WAIT_STEP_USECS);
+    }
+    if (finished != SPAWNERS * TASKS_PER_SPAWNER)
+    {
+        fprintf(stderr, "only %d of %d tasks finished\n", finished, SPAWNERS * TASKS_PER_SPAWNER);
+        exit(1);
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Regression test: terminating the owner of the mutex must release it, so the threads waiting
+ * for it, and those that lock it later, get it, and a thread that reuses the owner's ID does not
+ * inherit the lock.
+ * Exits with 0 when every thread got the mutex, 1 otherwise.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "uthreads.h"
+
+#define WAIT_STEP_USECS 1000
+#define WAIT_STEPS 1000
+
+static volatile bool ownerLocked;
+static volatile int acquired;
+static volatile int unlockFailures;
+
+static void owner()
+{
+    uthread_mutex_lock();
+    ownerLocked = true;
+    uthread_block(uthread_get_tid());
+}
+
+static void lock_and_unlock()
+{
+    uthread_mutex_lock();
+    acquired++;
+    if (uthread_mutex_unlock() != 0)
+    {
+        unlockFailures++;
+    }
+}
+
+static void waiter()
+{
+    lock_and_unlock();
+    for (;;)
+    {
+        uthread_park();
+    }
+}
+
+/**
+ * Blocks before locking, so it only asks for the mutex once its owner is gone.
+ */
+static void late_waiter()
+{
+    uthread_block(uthread_get_tid());
+    waiter();
+}
+
+static bool wait_for(int count)
+{
+    for (int step = 0; step < WAIT_STEPS && acquired < count; ++step)
+    {
+        uthread_sleep(WAIT_STEP_USECS);
+    }
+    return acquired >= count;
+}
+
+int main()
+{
+    if (uthread_init(1000) != 0)
+    {
+        return 1;
+    }
+    int ownerId = uthread_spawn(owner);
+    for (int step = 0; step < WAIT_STEPS && !ownerLocked; ++step)
+    {
+        uthread_sleep(WAIT_STEP_USECS);
+    }
+    uthread_spawn(waiter);
+    int lateId = uthread_spawn(late_waiter);
+    uthread_sleep(10 * WAIT_STEP_USECS);
+
+    uthread_terminate(ownerId);
+    uthread_resume(lateId);
+    bool waitersAcquired = wait_for(2);
+    // the next spawn takes the owner's ID, and must still have to lock the mutex itself
+    uthread_spawn(waiter);
+    bool reusedAcquired = waitersAcquired && wait_for(3);
+
+    if (!ownerLocked || !reusedAcquired || unlockFailures != 0)
+    {
+        fprintf(stderr, "%d of 3 threads got the mutex, %d unlocks failed\n", acquired,
+                unlockFailures);
+        exit(1);
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <cstddef>
+#include <new>
+#include "uthreads.h"
+
+#ifndef EX2_OS_UTHREAD_ALLOCATOR_H
+#define EX2_OS_UTHREAD_ALLOCATOR_H
+
+/**
+ * A standard allocator on top of uthread_alloc/uthread_free, so containers owned by a uthread
+ * allocate from that thread's arena, e.g. std::vector<int, uthread_allocator<int>>.
+ */
+template <class T>
+class uthread_allocator
+{
+public:
+    typedef T value_type;
+
+    uthread_allocator() noexcept
+    {
+    }
+
+    template <class U>
+    uthread_allocator(const uthread_allocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        void* block = uthread_alloc(n * sizeof(T));
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(block);
+    }
+
+    void deallocate(T* ptr, std::size_t)
+    {
+        uthread_free(ptr);
+    }
+};
+
+template <class T, class U>
+bool operator==(const uthread_allocator<T>&, const uthread_allocator<U>&)
+{
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const uthread_allocator<T>&, const uthread_allocator<U>&)
+{
+    return false;
+}
+
+
+#endif //EX2_OS_UTHREAD_ALLOCATOR_H
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <new>
+#include "uthread_executor.h"
+#include "Executor.h"
+
+#define SUCCESS 0
+#define FAIL -1
+#define THREAD_LIBRARY_ERROR "thread library error: "
+#define EXECUTOR_CREATE_ERR_MSG "invalid worker count or queue capacity."
+#define EXECUTOR_SPAWN_ERR_MSG "Not able to spawn the executor's workers."
+#define EXECUTOR_NULL_ERR_MSG "invalid executor."
+#define TASK_NULL_ERR_MSG "invalid task, NULL function."
+#define EXECUTOR_DESTROY_ERR_MSG "An executor cannot be destroyed by its own worker."
+
+
+/*
+ * Description: This function creates an executor with n_workers worker
+ * threads and a task queue holding at least queue_capacity tasks.
+ * Return value: On success, return the executor. On failure, return NULL.
+*/
+uthread_executor_t* uthread_executor_create(int n_workers, int queue_capacity)
+{
+    if (n_workers <= 0 || queue_capacity <= 0)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_CREATE_ERR_MSG);
+        return nullptr;
+    }
+    Executor* executor = new(std::nothrow) Executor(queue_capacity);
+    if (executor == nullptr)
+    {
+        return nullptr;
+    }
+    if (!executor->start(n_workers))
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_SPAWN_ERR_MSG);
+        delete executor;
+        return nullptr;
+    }
+    return executor;
+}
+
+/*
+ * Description: This function queues fn(arg) to run on one of the executor's
+ * workers.
+ * Return value: On success, return 0. If the queue is full, or executor or
+ * fn is NULL, return -1.
+*/
+int uthread_executor_submit(uthread_executor_t* executor, void (*fn)(void*), void* arg)
+{
+    if (executor == nullptr)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_NULL_ERR_MSG);
+        return FAIL;
+    }
+    if (fn == nullptr)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, TASK_NULL_ERR_MSG);
+        return FAIL;
+    }
+    return executor->submit(fn, arg) ? SUCCESS : FAIL;
+}
+
+/*
+ * Description: This function copies the executor's counters into *stats.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_executor_stats(uthread_executor_t* executor, uthread_executor_stats_t* stats)
+{
+    if (executor == nullptr || stats == nullptr)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_NULL_ERR_MSG);
+        return FAIL;
+    }
+    executor->getStats(stats);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function terminates the executor's workers and frees it.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_executor_destroy(uthread_executor_t* executor)
+{
+    if (executor == nullptr)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_NULL_ERR_MSG);
+        return FAIL;
+    }
+    if (executor->isWorker(uthread_get_tid()))
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, EXECUTOR_DESTROY_ERR_MSG);
+        return FAIL;
+    }
+    delete executor;
+    return SUCCESS;
+}
@@ -0,0 +1,61 @@
+#ifndef _UTHREAD_EXECUTOR_H
+#define _UTHREAD_EXECUTOR_H
+
+/*
+ * Task executor on top of the uthreads library: many short tasks multiplexed
+ * over a fixed pool of worker threads.
+ */
+
+#define EXECUTOR_BATCH_SIZE 32 /* maximal number of tasks a worker takes at once */
+
+typedef struct Executor uthread_executor_t;
+
+typedef struct
+{
+    unsigned long long submitted; /* tasks accepted by uthread_executor_submit */
+    unsigned long long rejected; /* submits refused because the queue was full */
+    unsigned long long completed; /* tasks that finished running */
+    unsigned long long batches; /* batches dequeued by the workers */
+    unsigned int queue_depth; /* tasks waiting right now */
+    unsigned int max_queue_depth; /* most tasks ever waiting at once */
+    unsigned long long total_latency_nsecs; /* sum over completed tasks of submit-to-start time */
+    unsigned long long max_latency_nsecs; /* longest submit-to-start time */
+} uthread_executor_stats_t;
+
+
+/*
+ * Description: This function creates an executor with n_workers worker
+ * threads and a task queue holding at least queue_capacity tasks. Workers
+ * with nothing to do park until a task is submitted. It is an error to pass a
+ * non-positive n_workers or queue_capacity, or more workers than there are
+ * free threads.
+ * Return value: On success, return the executor. On failure, return NULL.
+*/
+uthread_executor_t* uthread_executor_create(int n_workers, int queue_capacity);
+
+
+/*
+ * Description: This function queues fn(arg) to run on one of the executor's
+ * workers. The queue is lock-free, so any thread may submit without blocking.
+ * Return value: On success, return 0. If the queue is full, or executor or
+ * fn is NULL, return -1.
+*/
+int uthread_executor_submit(uthread_executor_t* executor, void (*fn)(void*), void* arg);
+
+
+/*
+ * Description: This function copies the executor's counters into *stats.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_executor_stats(uthread_executor_t* executor, uthread_executor_stats_t* stats);
+
+
+/*
+ * Description: This function terminates the executor's workers and frees it.
+ * Tasks still queued are dropped. It is an error to call it from one of the
+ * executor's own workers.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_executor_destroy(uthread_executor_t* executor);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <string.h>
+#include "uthreads.h"
+
+#ifndef EX2_OS_UTHREAD_METRICS_H
+#define EX2_OS_UTHREAD_METRICS_H
+
+/*
+ * The layout of the shared-memory segment uthread_metrics_publish maps. It is fixed: fields are
+ * only ever added at the end, with a higher version, so a reader built against an older header
+ * keeps working on newer segments by reading only the part it knows.
+ *
+ * The scheduler is the only writer. It rewrites the segment in place at every switch, as a
+ * seqlock: seq is odd while an update is under way and moves on by 2 for each update, so a copy
+ * taken between two equal, even reads of seq is consistent. uthread_metrics_snapshot does that.
+ */
+
+#define UTHREAD_METRICS_MAGIC 0x4d544855u /* "UHTM" */
+#define UTHREAD_METRICS_VERSION 1
+#define UTHREAD_METRICS_READ_TRIES 1000 /* copies uthread_metrics_snapshot tries before giving up */
+
+/* thread states, as published */
+#define UTHREAD_METRICS_FREE (-1) /* no thread has this ID */
+#define UTHREAD_METRICS_RUNNING 0
+#define UTHREAD_METRICS_READY 1
+#define UTHREAD_METRICS_BLOCKED 2
+#define UTHREAD_METRICS_BLOCKED_MUTEX 3
+#define UTHREAD_METRICS_BLOCKED_AND_BLOCKED_MUTEX 4
+#define UTHREAD_METRICS_WAITING_PERIOD 5
+#define UTHREAD_METRICS_THROTTLED 6
+
+#define UTHREAD_METRICS_IDLE (-1) /* running_tid while no thread is READY */
+
+struct uthread_metrics_thread
+{
+    int32_t state;
+    int32_t quantums;
+};
+
+struct uthread_metrics
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; /* sizeof(struct uthread_metrics) of the writer */
+    uint32_t max_threads;
+    uint32_t seq;
+    int32_t pid;
+    int32_t quantum_usecs;
+    int32_t running_tid;
+    int64_t total_quantums;
+    int32_t ready_depth; /* READY threads, in every ready queue */
+    int32_t mutex_owner; /* -1 while unlocked */
+    int32_t mutex_waiters;
+    int32_t reserved;
+    struct uthread_metrics_thread threads[MAX_THREAD_NUM];
+};
+
+/*
+ * Description: This function copies a consistent snapshot of a published
+ * segment into copy. It never blocks the writer: it retries while the
+ * scheduler is in the middle of an update. It is an error if the segment
+ * does not hold metrics of this version or a later one, or if no consistent
+ * copy could be taken in UTHREAD_METRICS_READ_TRIES tries (the process died
+ * mid-update).
+ * Return value: On success, return 0. On failure, return -1.
+*/
+static inline int uthread_metrics_snapshot(const struct uthread_metrics* shared,
+                                           struct uthread_metrics* copy)
+{
+    if (shared->magic != UTHREAD_METRICS_MAGIC || shared->version < UTHREAD_METRICS_VERSION ||
+        shared->size < sizeof(struct uthread_metrics))
+    {
+        return -1;
+    }
+    for (int i = 0; i < UTHREAD_METRICS_READ_TRIES; ++i)
+    {
+        uint32_t before = __atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+        {
+            continue;
+        }
+        memcpy(copy, shared, sizeof(struct uthread_metrics));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shared->seq, __ATOMIC_RELAXED) == before)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#endif //EX2_OS_UTHREAD_METRICS_H
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <new>
+#include "uthread_pipeline.h"
+#include "Pipeline.h"
+
+#define SUCCESS 0
+#define FAIL -1
+#define THREAD_LIBRARY_ERROR "thread library error: "
+#define PIPELINE_NULL_ERR_MSG "invalid pipeline."
+#define STAGE_ADD_ERR_MSG "invalid stage handler, thread count, queue capacity or batch size."
+#define STAGE_SPAWN_ERR_MSG "Too many stages or not able to spawn the stage's workers."
+#define INVALID_STAGE_ERR_MSG "No stage with this number exists."
+#define STAGE_THREADS_ERR_MSG "No stage with this number exists or invalid thread count."
+#define STAGE_BATCH_ERR_MSG "No stage with this number exists or invalid batch size."
+#define PIPELINE_DESTROY_ERR_MSG "A pipeline cannot be destroyed by its own worker."
+
+static int print_error(const char* message)
+{
+    fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, message);
+    return FAIL;
+}
+
+static bool valid_batch_size(int batch_size)
+{
+    return batch_size > 0 && batch_size <= UTHREAD_PIPELINE_MAX_BATCH;
+}
+
+
+/*
+ * Description: This function creates an empty pipeline.
+ * Return value: On success, return the pipeline. On failure, return NULL.
+*/
+uthread_pipeline_t* uthread_pipeline_create()
+{
+    return new(std::nothrow) Pipeline();
+}
+
+/*
+ * Description: This function appends a stage to the pipeline.
+ * Return value: On success, return the stage number. On failure, return -1.
+*/
+int uthread_pipeline_add_stage(uthread_pipeline_t* pipeline, uthread_stage_fn fn, void* arg,
+                               int n_threads, int queue_capacity, int batch_size)
+{
+    if (pipeline == nullptr)
+    {
+        return print_error(PIPELINE_NULL_ERR_MSG);
+    }
+    if (fn == nullptr || n_threads <= 0 || queue_capacity <= 0 || !valid_batch_size(batch_size))
+    {
+        return print_error(STAGE_ADD_ERR_MSG);
+    }
+    int stage = pipeline->addStage(fn, arg, n_threads, queue_capacity, batch_size);
+    if (stage == FAIL)
+    {
+        return print_error(STAGE_SPAWN_ERR_MSG);
+    }
+    return stage;
+}
+
+/*
+ * Description: This function queues item for the stage, parking while the
+ * queue is full.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_enqueue(uthread_pipeline_t* pipeline, int stage, void* item)
+{
+    if (pipeline == nullptr)
+    {
+        return print_error(PIPELINE_NULL_ERR_MSG);
+    }
+    PipelineStage* target = pipeline->getStage(stage);
+    if (target == nullptr)
+    {
+        return print_error(INVALID_STAGE_ERR_MSG);
+    }
+    target->enqueue(item);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function changes the number of workers of the stage.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_set_threads(uthread_pipeline_t* pipeline, int stage, int n_threads)
+{
+    PipelineStage* target = (pipeline == nullptr) ? nullptr : pipeline->getStage(stage);
+    if (target == nullptr || n_threads <= 0 || !target->setThreadCount(n_threads))
+    {
+        return print_error(STAGE_THREADS_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function changes the maximal batch size of the stage.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_set_batch_size(uthread_pipeline_t* pipeline, int stage, int batch_size)
+{
+    PipelineStage* target = (pipeline == nullptr) ? nullptr : pipeline->getStage(stage);
+    if (target == nullptr || !valid_batch_size(batch_size))
+    {
+        return print_error(STAGE_BATCH_ERR_MSG);
+    }
+    target->setBatchSize(batch_size);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function copies the stage's counters into *stats.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_stats(uthread_pipeline_t* pipeline, int stage,
+                           uthread_pipeline_stage_stats_t* stats)
+{
+    PipelineStage* target = (pipeline == nullptr) ? nullptr : pipeline->getStage(stage);
+    if (target == nullptr || stats == nullptr)
+    {
+        return print_error(INVALID_STAGE_ERR_MSG);
+    }
+    target->getStats(stats);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function terminates the workers of every stage and frees
+ * the pipeline.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_destroy(uthread_pipeline_t* pipeline)
+{
+    if (pipeline == nullptr)
+    {
+        return print_error(PIPELINE_NULL_ERR_MSG);
+    }
+    if (pipeline->isWorker(uthread_get_tid()))
+    {
+        return print_error(PIPELINE_DESTROY_ERR_MSG);
+    }
+    delete pipeline;
+    return SUCCESS;
+}
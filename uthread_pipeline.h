@@ -0,0 +1,113 @@
+#ifndef _UTHREAD_PIPELINE_H
+#define _UTHREAD_PIPELINE_H
+
+/*
+ * Staged pipeline on top of the uthreads library: a chain of stages, each a
+ * bounded queue drained by its own set of worker threads. Workers take items
+ * in batches, so a full queue costs one switch per batch rather than one per
+ * item.
+ */
+
+#define UTHREAD_PIPELINE_MAX_STAGES 16 /* maximal number of stages per pipeline */
+#define UTHREAD_PIPELINE_MAX_BATCH 256 /* maximal number of items a worker takes at once */
+
+typedef struct Pipeline uthread_pipeline_t;
+
+/*
+ * A stage's handler: it gets up to the stage's batch size items at once, and
+ * passes each on to the next stage with uthread_pipeline_enqueue (or drops
+ * it). It runs on a worker's stack, which is only STACK_SIZE bytes.
+ */
+typedef void (*uthread_stage_fn)(void** items, int count, void* arg);
+
+typedef struct
+{
+    unsigned long long enqueued; /* items accepted by uthread_pipeline_enqueue */
+    unsigned long long dequeued; /* items taken by the workers */
+    unsigned long long processed; /* items the handler returned from */
+    unsigned long long batches; /* batches dequeued by the workers */
+    unsigned long long producer_parks; /* times a producer parked on the full queue */
+    unsigned int queue_length; /* items waiting right now */
+    unsigned int max_queue_length; /* most items ever waiting at once */
+    unsigned int batch_size; /* current maximal batch size */
+    unsigned int threads; /* current number of workers */
+    unsigned long long total_latency_nsecs; /* enqueue-to-dequeue time, summed over dequeued items */
+    unsigned long long max_latency_nsecs; /* longest enqueue-to-dequeue time */
+} uthread_pipeline_stage_stats_t;
+
+
+/*
+ * Description: This function creates an empty pipeline.
+ * Return value: On success, return the pipeline. On failure, return NULL.
+*/
+uthread_pipeline_t* uthread_pipeline_create();
+
+
+/*
+ * Description: This function appends a stage to the pipeline: a queue
+ * holding at least queue_capacity items, drained by n_threads worker threads
+ * that call fn(items, count, arg) on up to batch_size items at a time. A
+ * worker takes whatever is queued, up to batch_size, so batches grow with
+ * the backlog instead of waiting to fill. Workers with nothing to do park
+ * until an item arrives. Stages are numbered from 0 in the order they are
+ * added, and should be added by a single thread. It is an error to pass a
+ * NULL fn, a non-positive n_threads or queue_capacity, a batch_size outside
+ * [1, UTHREAD_PIPELINE_MAX_BATCH], to exceed UTHREAD_PIPELINE_MAX_STAGES
+ * stages, or to ask for more workers than there are free threads.
+ * Return value: On success, return the stage number. On failure, return -1.
+*/
+int uthread_pipeline_add_stage(uthread_pipeline_t* pipeline, uthread_stage_fn fn, void* arg,
+                               int n_threads, int queue_capacity, int batch_size);
+
+
+/*
+ * Description: This function queues item for the stage. While the queue is
+ * full, the calling thread parks until a worker of the stage makes room, so
+ * a fast stage is slowed down to the pace of the one it feeds. Any thread,
+ * including the workers of other stages, may enqueue. It is an error to pass
+ * a NULL pipeline or a stage that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_enqueue(uthread_pipeline_t* pipeline, int stage, void* item);
+
+
+/*
+ * Description: This function changes the number of workers of the stage to
+ * n_threads. New workers are spawned at once; surplus ones exit once they
+ * finish their current batch. It is an error to pass a stage that does not
+ * exist, a non-positive n_threads, or more workers than there are free
+ * threads (the workers spawned before the failure are kept).
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_set_threads(uthread_pipeline_t* pipeline, int stage, int n_threads);
+
+
+/*
+ * Description: This function changes the maximal batch size of the stage,
+ * from the next batch on. It is an error to pass a stage that does not exist
+ * or a batch_size outside [1, UTHREAD_PIPELINE_MAX_BATCH].
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_set_batch_size(uthread_pipeline_t* pipeline, int stage, int batch_size);
+
+
+/*
+ * Description: This function copies the stage's counters into *stats. The
+ * average batch is dequeued / batches and the average queueing latency
+ * total_latency_nsecs / dequeued.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_stats(uthread_pipeline_t* pipeline, int stage,
+                           uthread_pipeline_stage_stats_t* stats);
+
+
+/*
+ * Description: This function terminates the workers of every stage and
+ * frees the pipeline. Items still queued are dropped. No thread may be
+ * enqueueing to the pipeline. It is an error to call it from one of the
+ * pipeline's own workers.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_pipeline_destroy(uthread_pipeline_t* pipeline);
+
+#endif
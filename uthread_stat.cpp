@@ -0,0 +1,143 @@
+/*
+ * Reads the metrics a uthreads process publishes with uthread_metrics_publish, from outside the
+ * process: the segment is mapped read-only and copied with uthread_metrics_snapshot, so the
+ * monitored scheduler never waits for the reader.
+ * Usage: uthread_stat [-t] segment_name [interval_msecs [count]]
+ *        -t adds one line per live thread to every sample.
+ * Example: uthread_stat -t /uthreads.1234 1000
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "uthread_metrics.h"
+
+#define DEFAULT_INTERVAL_MSECS 1000
+#define MICRO_SECONDS_IN_MILLI 1000
+
+static const char* state_name(int state)
+{
+    switch (state)
+    {
+        case UTHREAD_METRICS_RUNNING:
+            return "running";
+        case UTHREAD_METRICS_READY:
+            return "ready";
+        case UTHREAD_METRICS_BLOCKED:
+            return "blocked";
+        case UTHREAD_METRICS_BLOCKED_MUTEX:
+            return "mutex";
+        case UTHREAD_METRICS_BLOCKED_AND_BLOCKED_MUTEX:
+            return "blocked+mutex";
+        case UTHREAD_METRICS_WAITING_PERIOD:
+            return "period";
+        case UTHREAD_METRICS_THROTTLED:
+            return "throttled";
+        default:
+            return "?";
+    }
+}
+
+static void print_sample(const uthread_metrics& now, const uthread_metrics& before, int intervalMsecs,
+                         bool threads)
+{
+    int live = 0;
+    int blocked = 0;
+    for (int id = 0; id < MAX_THREAD_NUM; ++id)
+    {
+        int state = now.threads[id].state;
+        live += (state != UTHREAD_METRICS_FREE);
+        blocked += (state == UTHREAD_METRICS_BLOCKED || state == UTHREAD_METRICS_BLOCKED_MUTEX ||
+                    state == UTHREAD_METRICS_BLOCKED_AND_BLOCKED_MUTEX);
+    }
+    char running[16];
+    if (now.running_tid == UTHREAD_METRICS_IDLE)
+    {
+        snprintf(running, sizeof(running), "idle");
+    }
+    else
+    {
+        snprintf(running, sizeof(running), "%d", now.running_tid);
+    }
+    printf("pid %d: quantums %lld (+%lld/s) running %s threads %d ready %d blocked %d "
+           "mutex owner %d waiters %d\n",
+           now.pid, (long long) now.total_quantums,
+           (long long) (now.total_quantums - before.total_quantums) * 1000 / intervalMsecs,
+           running, live, now.ready_depth, blocked, now.mutex_owner, now.mutex_waiters);
+    if (!threads)
+    {
+        return;
+    }
+    for (int id = 0; id < MAX_THREAD_NUM; ++id)
+    {
+        if (now.threads[id].state != UTHREAD_METRICS_FREE)
+        {
+            printf("  tid %3d %-14s quantums %d\n", id, state_name(now.threads[id].state),
+                   now.threads[id].quantums);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool threads = false;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-t") == 0)
+    {
+        threads = true;
+        arg++;
+    }
+    if (arg >= argc)
+    {
+        fprintf(stderr, "usage: uthread_stat [-t] segment_name [interval_msecs [count]]\n");
+        return 1;
+    }
+    const char* name = argv[arg];
+    int intervalMsecs = (arg + 1 < argc) ? atoi(argv[arg + 1]) : DEFAULT_INTERVAL_MSECS;
+    int count = (arg + 2 < argc) ? atoi(argv[arg + 2]) : -1;
+    if (intervalMsecs <= 0)
+    {
+        fprintf(stderr, "uthread_stat: the interval must be positive\n");
+        return 1;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        perror("uthread_stat: shm_open");
+        return 1;
+    }
+    void* segment = mmap(nullptr, sizeof(uthread_metrics), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        perror("uthread_stat: mmap");
+        return 1;
+    }
+    const uthread_metrics* shared = (const uthread_metrics*) segment;
+
+    uthread_metrics before;
+    uthread_metrics now;
+    if (uthread_metrics_snapshot(shared, &before) != 0)
+    {
+        fprintf(stderr, "uthread_stat: %s holds no readable uthreads metrics\n", name);
+        return 1;
+    }
+    for (int i = 0; count < 0 || i < count; ++i)
+    {
+        usleep(intervalMsecs * MICRO_SECONDS_IN_MILLI);
+        if (uthread_metrics_snapshot(shared, &now) != 0)
+        {
+            fprintf(stderr, "uthread_stat: no consistent copy of %s\n", name);
+            return 1;
+        }
+        print_sample(now, before, intervalMsecs, threads);
+        fflush(stdout);
+        before = now;
+    }
+    munmap(segment, sizeof(uthread_metrics));
+    return 0;
+}
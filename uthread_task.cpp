@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include "uthread_task.h"
+
+#define SUCCESS 0
+#define FAIL -1
+#define THREAD_LIBRARY_ERROR "thread library error: "
+#define CO_SPAWN_ERR_MSG "invalid task or not able to spawn the coroutine host thread."
+#define CO_MUTEX_UNLOCK_ERR_MSG "No task holds the mutex."
+
+namespace uthread
+{
+
+/*
+ * Description: This function releases the library mutex held by a task,
+ * handing it to the next waiting task if there is one.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int mutex_unlock()
+{
+    if (CoroutineScheduler::unlock_mutex() == FAIL)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, CO_MUTEX_UNLOCK_ERR_MSG);
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function starts t as a detached task.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int co_spawn(task<void>&& t)
+{
+    std::coroutine_handle<detail::promise<void>> handle = t.release();
+    if (!handle)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, CO_SPAWN_ERR_MSG);
+        return FAIL;
+    }
+    handle.promise().detached = true;
+    if (!CoroutineScheduler::spawn(&handle.promise()))
+    {
+        handle.destroy();
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, CO_SPAWN_ERR_MSG);
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+} // namespace uthread
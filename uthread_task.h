@@ -0,0 +1,326 @@
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "uthreads.h"
+#include "CoroutineScheduler.h"
+
+#ifndef EX2_OS_UTHREAD_TASK_H
+#define EX2_OS_UTHREAD_TASK_H
+
+/*
+ * Stackless C++20 coroutines on top of the uthreads library. A coroutine costs one frame from
+ * the uthread arenas instead of a Thread with its own stack, and all of them share a single host
+ * thread scheduled like any other uthread. Requires C++20 (the uthreads_coro target).
+ */
+namespace uthread
+{
+
+template <class T = void>
+class task;
+
+namespace detail
+{
+
+/**
+ * What every task's promise shares: the scheduler node, the frame allocation and the hand-off to
+ * the awaiting coroutine when the body finishes.
+ */
+struct promise_base : CoroutineNode
+{
+    std::coroutine_handle<> continuation;
+
+    struct final_awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        /**
+         * Resumes the awaiting coroutine without growing the stack; a detached task has nobody
+         * waiting and frees its own frame.
+         */
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            promise_base& promise = handle.promise();
+            if (promise.continuation)
+            {
+                return promise.continuation;
+            }
+            if (promise.detached)
+            {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    promise_base() noexcept
+    {
+        next = nullptr;
+        wakeUsecs = 0;
+        detached = false;
+    }
+
+    /**
+     * A frame lives on the host, so only the host may take it from its own arena. Frames made on
+     * other threads come from the shared arena, which outlives the thread that called co_spawn.
+     */
+    static void* operator new(std::size_t size)
+    {
+        void* frame = CoroutineScheduler::is_host() ? uthread_alloc(size) :
+                      uthread_alloc_shared(size);
+        if (frame == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return frame;
+    }
+
+    static void operator delete(void* frame)
+    {
+        uthread_free(frame);
+    }
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    final_awaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        std::terminate();
+    }
+};
+
+template <class T>
+struct promise : promise_base
+{
+    T value;
+
+    task<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U&& result)
+    {
+        value = std::forward<U>(result);
+    }
+};
+
+template <>
+struct promise<void> : promise_base
+{
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {
+    }
+};
+
+} // namespace detail
+
+/**
+ * A lazily started coroutine returning T. It runs when it is co_awaited, which also joins it and
+ * yields its result, or when it is handed to co_spawn. Awaiting it from another task resumes the
+ * child directly, so a chain of awaits never grows the host's stack.
+ */
+template <class T>
+class task
+{
+public:
+    typedef detail::promise<T> promise_type;
+
+    task() noexcept : _handle(nullptr)
+    {
+    }
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : _handle(handle)
+    {
+    }
+
+    task(task&& other) noexcept : _handle(other._handle)
+    {
+        other._handle = nullptr;
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_handle)
+            {
+                _handle.destroy();
+            }
+            _handle = other._handle;
+            other._handle = nullptr;
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+
+    task& operator=(const task&) = delete;
+
+    ~task()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    /**
+     * Gives up ownership of the frame, e.g. to co_spawn.
+     */
+    std::coroutine_handle<promise_type> release() noexcept
+    {
+        std::coroutine_handle<promise_type> handle = _handle;
+        _handle = nullptr;
+        return handle;
+    }
+
+    struct awaiter
+    {
+        std::coroutine_handle<promise_type> child;
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            child.promise().continuation = awaiting;
+            return child;
+        }
+
+        T await_resume()
+        {
+            if constexpr (!std::is_void<T>::value)
+            {
+                return std::move(child.promise().value);
+            }
+        }
+    };
+
+    awaiter operator co_await() && noexcept
+    {
+        return awaiter{_handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+namespace detail
+{
+
+template <class T>
+task<T> promise<T>::get_return_object() noexcept
+{
+    std::coroutine_handle<promise<T>> handle =
+            std::coroutine_handle<promise<T>>::from_promise(*this);
+    this->handle = handle;
+    return task<T>(handle);
+}
+
+inline task<void> promise<void>::get_return_object() noexcept
+{
+    std::coroutine_handle<promise<void>> handle =
+            std::coroutine_handle<promise<void>>::from_promise(*this);
+    this->handle = handle;
+    return task<void>(handle);
+}
+
+} // namespace detail
+
+/**
+ * co_await sleep_for(usecs) suspends the calling task for usecs micro-seconds while the host
+ * runs the other tasks.
+ */
+class sleep_for
+{
+public:
+    explicit sleep_for(int usecs) noexcept : _usecs(usecs)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return _usecs <= 0;
+    }
+
+    template <class Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        return CoroutineScheduler::sleep(&handle.promise(), _usecs);
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    int _usecs;
+};
+
+/**
+ * co_await mutex_lock() acquires the library mutex for the calling task. Tasks waiting for each
+ * other suspend; a stackful thread holding the mutex blocks the whole host until it unlocks.
+ */
+class mutex_lock
+{
+public:
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <class Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        return !CoroutineScheduler::lock_mutex(&handle.promise());
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+};
+
+
+/*
+ * Description: This function releases the library mutex held by a task,
+ * handing it straight to the next task waiting in mutex_lock if there is
+ * one. It must be called from a task. If no task holds the mutex, it is
+ * considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int mutex_unlock();
+
+
+/*
+ * Description: This function starts t as a detached task: nobody joins it
+ * and its frame is freed when it finishes. Any thread may spawn tasks; the
+ * first call spawns the host thread that runs them, which takes one of the
+ * MAX_THREAD_NUM threads. It is an error to pass an empty task.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int co_spawn(task<void>&& t);
+
+} // namespace uthread
+
+
+#endif //EX2_OS_UTHREAD_TASK_H
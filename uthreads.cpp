@@ -1,235 +1,1192 @@
-#include <iostream>
-#include <stdlib.h>
-#include <queue>
-#include "uthreads.h"
-#include "signal.h"
-#include "Thread.h"
-#include "sync_handler.h"
-
-#define SUCCESS 0
-#define FAIL -1
-#define UNLOCKED -1
-#define NON_NEGATIVE_INT 0
-#define MAIN 0
-#define THREAD_LIBRARY_ERROR "thread library error: "
-#define SYSTEM_ERROR "system error: "
-#define SPAWN_ERR_MSG "Num of concurrent threads exceeds limit, not able to create new thread."
-#define INIT_ERR_MSG "invalid quantum usecs, non-positive integer"
-#define INVALID_TID_ERR_MSG "No thread with ID tid exits."
-#define BLOCK_ERR_MSG "No thread with ID tid exists or it's invalid to block main thread."
-#define MUTEX_ERR_MSG "Invalid - the mutex is already locked by this thread."
-#define MUTEX_UNLOCK_ERR_MSG "INVALID - The mutex is already unlocked."
-
-
- /**
-  * @brief
-  */
-  static sync_handler _syncHandler;
-
-
-/*
- * Description: This function initializes the thread library.
- * You may assume that this function is called before any other thread library
- * function, and that it is called exactly once. The input to the function is
- * the length of a quantum in micro-seconds. It is an error to call this
- * function with non-positive quantum_usecs.
- * Return value: On success, return 0. On failure, return -1.
-*/
-int uthread_init(int quantum_usecs)
-{
-    if (quantum_usecs <= NON_NEGATIVE_INT)
-    {
-        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, INIT_ERR_MSG);
-        return FAIL;
-    }
-    _syncHandler.init_sync_handler(quantum_usecs);
-    return SUCCESS;
-}
-
-/*
- * Description: This function creates a new thread, whose entry point is the
- * function f with the signature void f(void). The thread is added to the end
- * of the READY threads list. The uthread_spawn function should fail if it
- * would cause the number of concurrent threads to exceed the limit
- * (MAX_THREAD_NUM). Each thread should be allocated with a stack of size
- * STACK_SIZE bytes.
- * Return value: On success, return the ID of the created thread.
- * On failure, return -1.
-*/
-int uthread_spawn(void (*f)(void)){
-    if(!_syncHandler.can_add_new_thread())
-    {
-        return _syncHandler.return_and_print_error(SPAWN_ERR_MSG);
-    }
-
-    return _syncHandler.create_new_thread(f);
-
-}
-
-/*
- * Description: This function terminates the thread with ID tid and deletes
- * it from all relevant control structures. All the resources allocated by
- * the library for this thread should be released. If no thread with ID tid
- * exists it is considered an error. Terminating the main thread
- * (tid == 0) will result in the termination of the entire process using
- * exit(0) [after releasing the assigned library memory].
- * Return value: The function returns 0 if the thread was successfully
- * terminated and -1 otherwise. If a thread terminates itself or the main
- * thread is terminated, the function does not return.
-*/
-int uthread_terminate(int tid)
-{
-    Thread* currThread = _syncHandler.get_thread_by_id(tid);
-    if (currThread == nullptr)
-    {
-        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
-    }
-
-    if (currThread->getId() == MAIN || currThread->getState() == RUNNING)
-    {
-        _syncHandler.release_all_resources();
-        exit(SUCCESS);
-    }
-
-    // TODO : check if running state need a spaical tretment
-    _syncHandler.release_resources_by_thread(tid);
-    return SUCCESS;
-}
-
-/*
- * Description: This function blocks the thread with ID tid. The thread may
- * be resumed later using uthread_resume. If no thread with ID tid exists it
- * is considered as an error. In addition, it is an error to try blocking the
- * main thread (tid == 0). If a thread blocks itself, a scheduling decision
- * should be made. Blocking a thread in BLOCKED state has no
- * effect and is not considered an error.
- * Return value: On success, return 0. On failure, return -1.
-*/
-int uthread_block(int tid)
-{
-    // check if thread with this ID exists or if we are blocking the main thread
-    Thread* currThread = _syncHandler.get_thread_by_id(tid);
-    if (currThread == nullptr || currThread->getId() == MAIN)
-    {
-        return _syncHandler.return_and_print_error(BLOCK_ERR_MSG);
-    }
-
-    // if thread is in BLOCK status do nothing
-    if(currThread->getState() == BLOCKED || currThread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
-    {
-        return SUCCESS;
-    }
-
-    //change the thread to BLOCK status
-    _syncHandler.changeStateToBlocked(tid);
-
-    return SUCCESS;
-}
-
-/*
- * Description: This function resumes a blocked thread with ID tid and moves
- * it to the READY state if it's not synced. Resuming a thread in a RUNNING or READY state
- * has no effect and is not considered as an error. If no thread with
- * ID tid exists it is considered an error.
- * Return value: On success, return 0. On failure, return -1.
-*/
-int uthread_resume(int tid)
-{
-    //there is no thread with this id : error
-    Thread* currThread = _syncHandler.get_thread_by_id(tid);
-    if (currThread == nullptr)
-    {
-        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
-    }
-
-    //resume the blocked thread if it is not running or ready status
-    if(currThread->getState() != RUNNING || currThread->getState() != READY)
-    {
-        _syncHandler.resumeThread(tid);
-    }
-
-    return SUCCESS;
-}
-
-/*
- * Description: This function tries to acquire a mutex.
- * If the mutex is unlocked, it locks it and returns.
- * If the mutex is already locked by different thread, the thread moves to BLOCK state.
- * In the future when this thread will be back to RUNNING state,
- * it will try again to acquire the mutex.
- * If the mutex is already locked by this thread, it is considered an error.
- * Return value: On success, return 0. On failure, return -1.
-*/
-int uthread_mutex_lock()
-{
-    if (_syncHandler.get_mutex_thread_id() == _syncHandler.get_running_thread_id())
-    {
-        return _syncHandler.return_and_print_error(MUTEX_ERR_MSG);
-    }
-    return _syncHandler.lock_mutex();
-}
-
-
-/*
- * Description: This function releases a mutex.
- * If there are blocked threads waiting for this mutex,
- * one of them (no matter which one) moves to READY state.
- * If the mutex is already unlocked, it is considered an error.
- * Return value: On success, return 0. On failure, return -1.
-*/
-int uthread_mutex_unlock()
-{
-    if (_syncHandler.get_mutex_thread_id() == UNLOCKED)
-    {
-        return _syncHandler.return_and_print_error(MUTEX_UNLOCK_ERR_MSG);
-
-    }
-    return _syncHandler.unlock_mutex();
-
-}
-
-/*
- * Description: This function returns the thread ID of the calling thread.
- * Return value: The ID of the calling thread.
-*/
-int uthread_get_tid()
-{
-    //todo : calling thread can be only the running one ?
-    return _syncHandler.get_running_thread_id();
-}
-
-/*
- * Description: This function returns the total number of quantums since
- * the library was initialized, including the current quantum.
- * Right after the call to uthread_init, the value should be 1.
- * Each time a new quantum starts, regardless of the reason, this number
- * should be increased by 1.
- * Return value: The total number of quantums.
-*/
-int uthread_get_total_quantums()
-{
-    return _syncHandler.get_total_quantums();
-}
-
-/*
- * Description: This function returns the number of quantums the thread with
- * ID tid was in RUNNING state. On the first time a thread runs, the function
- * should return 1. Every additional quantum that the thread starts should
- * increase this value by 1 (so if the thread with ID tid is in RUNNING state
- * when this function is called, include also the current quantum). If no
- * thread with ID tid exists it is considered an error.
- * Return value: On success, return the number of quantums of the thread with ID tid.
- * 			     On failure, return -1.
-*/
-int uthread_get_quantums(int tid)
-{
-    //if no thread with ID tid it's an error
-    Thread* currThread = _syncHandler.get_thread_by_id(tid);
-    if (currThread == nullptr)
-    {
-        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
-    }
-
-    return _syncHandler.get_quantums_by_id(tid);
-}
-
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <queue>
+#include "uthreads.h"
+#include "signal.h"
+#include "Thread.h"
+#include "sync_handler.h"
+
+#define SUCCESS 0
+#define FAIL -1
+#define UNLOCKED -1
+#define NON_NEGATIVE_INT 0
+#define MAIN 0
+#define THREAD_LIBRARY_ERROR "thread library error: "
+#define SYSTEM_ERROR "system error: "
+#define SPAWN_ERR_MSG "Num of concurrent threads exceeds limit, not able to create new thread."
+#define INIT_ERR_MSG "invalid quantum usecs, non-positive integer"
+#define INIT_TIMER_ERR_MSG "invalid timer backend."
+#define ADAPTIVE_QUANTUM_ERR_MSG "invalid adaptive quantum bounds."
+#define SCHED_POLICY_ERR_MSG "invalid scheduling policy."
+#define WEIGHT_ERR_MSG "No thread with ID tid exists or the weight is not positive."
+#define QUOTA_ERR_MSG "No thread with ID tid exists or invalid quota and period."
+#define PRIORITY_ERR_MSG "No thread with ID tid exists or the priority is out of range."
+#define DEADLINE_ERR_MSG "No thread with ID tid exists or invalid period and budget."
+#define ADMISSION_ERR_MSG "Deadline thread rejected, the deadline class would exceed its CPU share."
+#define NOT_DEADLINE_ERR_MSG "The calling thread is not a deadline thread."
+#define KEY_CREATE_ERR_MSG "No free uthread-local storage key."
+#define INVALID_KEY_ERR_MSG "No uthread-local storage key with this value exists."
+#define TIMEOUT_ERR_MSG "invalid timeout, non-positive integer."
+#define INVALID_TID_ERR_MSG "No thread with ID tid exits."
+#define REMOTE_TID_ERR_MSG "thread library error: tid is out of range.\n"
+#define BLOCK_ERR_MSG "No thread with ID tid exists or it's invalid to block main thread."
+#define MUTEX_ERR_MSG "Invalid - the mutex is already locked by this thread."
+#define MUTEX_UNLOCK_ERR_MSG "INVALID - The mutex is already unlocked."
+#define SPAWN_MANY_ERR_MSG "invalid thread count or the threads would exceed the limit."
+#define BATCH_ERR_MSG "invalid thread count or ID array."
+#define RCU_UNLOCK_ERR_MSG "The calling thread is not in an RCU read-side critical section."
+#define RCU_CALLBACK_ERR_MSG "invalid RCU callback, NULL function."
+#define RCU_SYNCHRONIZE_ERR_MSG "uthread_synchronize_rcu called in an RCU read-side critical section."
+#define RCU_BARRIER_ERR_MSG "uthread_rcu_barrier called in an RCU read-side critical section."
+#define GROUP_CREATE_ERR_MSG "No free thread group ID."
+#define INVALID_GROUP_ERR_MSG "No thread group with this ID exists."
+#define GROUP_DESTROY_ERR_MSG "No thread group with this ID exists or it still has members."
+#define NOT_SIMULATED_ERR_MSG "The library was not initialized with UTHREAD_TIMER_SIMULATED."
+#define SIM_SEED_ERR_MSG "invalid jitter, not within [0, 100)."
+#define SIM_TICK_ERR_MSG "invalid tick, non-positive integer."
+#define SIM_RECORD_ERR_MSG "Writing the schedule failed."
+#define SIM_REPLAY_ERR_MSG "The file does not hold a recorded schedule."
+#define PROFILER_START_ERR_MSG "invalid sampling period, or the library runs a simulation."
+#define PROFILER_ALLOC_ERR_MSG "Allocating the profile samples failed."
+#define PROFILER_DUMP_ERR_MSG "Writing the profile failed."
+#define LOCK_PROFILER_ALLOC_ERR_MSG "Allocating the lock profile failed."
+#define LOCK_PROFILER_DUMP_ERR_MSG "invalid lock profile format or writing the lock profile failed."
+#define METRICS_PUBLISH_ERR_MSG "Creating the shared-memory metrics segment failed."
+#define STACK_PEAK_ERR_MSG "No thread with ID tid exists or its stack is not profiled."
+#define ENTRY_STACK_PEAK_ERR_MSG "No profiled thread was spawned with this entry function."
+#define STACK_DUMP_ERR_MSG "Writing the stack profile failed."
+
+
+ /**
+  * @brief
+  */
+  static sync_handler _syncHandler;
+
+
+/*
+ * Description: This function initializes the thread library.
+ * You may assume that this function is called before any other thread library
+ * function, and that it is called exactly once. The input to the function is
+ * the length of a quantum in micro-seconds. It is an error to call this
+ * function with non-positive quantum_usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_init(int quantum_usecs)
+{
+    return uthread_init_with_timer(quantum_usecs, UTHREAD_TIMER_VIRTUAL);
+}
+
+/*
+ * Description: Same as uthread_init, but selects the clock that drives
+ * preemption. It is an error to pass a non-positive quantum_usecs or an
+ * unknown timer_backend.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_init_with_timer(int quantum_usecs, int timer_backend)
+{
+    if (quantum_usecs <= NON_NEGATIVE_INT)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, INIT_ERR_MSG);
+        return FAIL;
+    }
+    if (timer_backend != UTHREAD_TIMER_VIRTUAL && timer_backend != UTHREAD_TIMER_MONOTONIC &&
+        timer_backend != UTHREAD_TIMER_THREAD_CPU && timer_backend != UTHREAD_TIMER_SIMULATED)
+    {
+        fprintf(stderr, "%s%s\n", THREAD_LIBRARY_ERROR, INIT_TIMER_ERR_MSG);
+        return FAIL;
+    }
+    _syncHandler.init_sync_handler(quantum_usecs, timer_backend);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function creates a new thread, whose entry point is the
+ * function f with the signature void f(void). The thread is added to the end
+ * of the READY threads list. The uthread_spawn function should fail if it
+ * would cause the number of concurrent threads to exceed the limit
+ * (MAX_THREAD_NUM). Each thread should be allocated with a stack of size
+ * STACK_SIZE bytes.
+ * Return value: On success, return the ID of the created thread.
+ * On failure, return -1.
+*/
+int uthread_spawn(void (*f)(void)){
+    if(!_syncHandler.can_add_new_thread())
+    {
+        return _syncHandler.return_and_print_error(SPAWN_ERR_MSG);
+    }
+
+    return _syncHandler.create_new_thread(f, NO_GROUP);
+
+}
+
+/*
+ * Description: This function terminates the thread with ID tid and deletes
+ * it from all relevant control structures. All the resources allocated by
+ * the library for this thread should be released. If no thread with ID tid
+ * exists it is considered an error. Terminating the main thread
+ * (tid == 0) will result in the termination of the entire process using
+ * exit(0) [after releasing the assigned library memory].
+ * Return value: The function returns 0 if the thread was successfully
+ * terminated and -1 otherwise. If a thread terminates itself or the main
+ * thread is terminated, the function does not return.
+*/
+int uthread_terminate(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+
+    if (currThread->getId() == MAIN)
+    {
+        _syncHandler.release_all_resources();
+        exit(SUCCESS);
+    }
+    if (currThread->getState() == RUNNING)
+    {
+        _syncHandler.terminate_running_thread();
+    }
+
+    // TODO : check if running state need a spaical tretment
+    _syncHandler.release_resources_by_thread(tid);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function blocks the thread with ID tid. The thread may
+ * be resumed later using uthread_resume. If no thread with ID tid exists it
+ * is considered as an error. In addition, it is an error to try blocking the
+ * main thread (tid == 0). If a thread blocks itself, a scheduling decision
+ * should be made. Blocking a thread in BLOCKED state has no
+ * effect and is not considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_block(int tid)
+{
+    // check if thread with this ID exists or if we are blocking the main thread
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr || currThread->getId() == MAIN)
+    {
+        return _syncHandler.return_and_print_error(BLOCK_ERR_MSG);
+    }
+
+    // if thread is in BLOCK status do nothing
+    if(currThread->getState() == BLOCKED || currThread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        return SUCCESS;
+    }
+
+    //change the thread to BLOCK status
+    _syncHandler.changeStateToBlocked(tid);
+
+    return SUCCESS;
+}
+
+/*
+ * Description: This function resumes a blocked thread with ID tid and moves
+ * it to the READY state if it's not synced. Resuming a thread in a RUNNING or READY state
+ * has no effect and is not considered as an error. If no thread with
+ * ID tid exists it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume(int tid)
+{
+    //there is no thread with this id : error
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+
+    //resume the thread only if it is blocked, waking a READY thread would queue it twice
+    if(currThread->getState() == BLOCKED || currThread->getState() == BLOCKED_AND_BLOCKED_MUTEX)
+    {
+        _syncHandler.resumeThread(tid);
+    }
+
+    return SUCCESS;
+}
+
+/*
+ * Description: This function creates an empty thread group and stores its ID
+ * in *group.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_create(uthread_group_t* group)
+{
+    int newGroup = _syncHandler.create_group();
+    if (newGroup == FAIL)
+    {
+        return _syncHandler.return_and_print_error(GROUP_CREATE_ERR_MSG);
+    }
+    *group = newGroup;
+    return SUCCESS;
+}
+
+/*
+ * Description: This function deletes an empty thread group.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_destroy(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group) || !_syncHandler.destroy_group(group))
+    {
+        return _syncHandler.return_and_print_error(GROUP_DESTROY_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: Same as uthread_spawn, but the new thread joins group.
+ * Return value: On success, return the ID of the created thread.
+ * On failure, return -1.
+*/
+int uthread_spawn_in_group(void (*f)(void), uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    if (!_syncHandler.can_add_new_thread())
+    {
+        return _syncHandler.return_and_print_error(SPAWN_ERR_MSG);
+    }
+    return _syncHandler.create_new_thread(f, group);
+}
+
+/*
+ * Description: This function blocks every member of group.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_block(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    _syncHandler.block_group(group);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function resumes every member of group.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_resume(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    _syncHandler.resume_group(group);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function terminates every member of group.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_terminate(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    _syncHandler.terminate_group(group);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the number of quantums of group.
+ * Return value: On success, return the number of quantums.
+ * On failure, return -1.
+*/
+int uthread_group_get_quantums(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    return _syncHandler.get_group_quantums(group);
+}
+
+/*
+ * Description: This function returns the CPU time of group.
+ * Return value: On success, return the run time. On failure, return -1.
+*/
+long long uthread_group_get_cpu_usecs(uthread_group_t group)
+{
+    if (!_syncHandler.is_valid_group(group))
+    {
+        return _syncHandler.return_and_print_error(INVALID_GROUP_ERR_MSG);
+    }
+    return _syncHandler.get_group_cpu_usecs(group);
+}
+
+/*
+ * Description: This function creates n threads at once and stores their IDs
+ * in tids.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_spawn_many(void (*const fns[])(void), int n, int tids[])
+{
+    if (n <= NON_NEGATIVE_INT || fns == nullptr || tids == nullptr ||
+        !_syncHandler.can_add_new_threads(n))
+    {
+        return _syncHandler.return_and_print_error(SPAWN_MANY_ERR_MSG);
+    }
+    return _syncHandler.create_many_threads(fns, n, tids);
+}
+
+/*
+ * Description: Same as calling uthread_block on tids[0..n-1], in a single
+ * critical section.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_block_many(const int tids[], int n)
+{
+    if (n <= NON_NEGATIVE_INT || n > MAX_THREAD_NUM || tids == nullptr)
+    {
+        return _syncHandler.return_and_print_error(BATCH_ERR_MSG);
+    }
+    if (!_syncHandler.block_many(tids, n))
+    {
+        return _syncHandler.return_and_print_error(BLOCK_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: Same as calling uthread_resume on tids[0..n-1], in a single
+ * critical section.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume_many(const int tids[], int n)
+{
+    if (n <= NON_NEGATIVE_INT || n > MAX_THREAD_NUM || tids == nullptr)
+    {
+        return _syncHandler.return_and_print_error(BATCH_ERR_MSG);
+    }
+    if (!_syncHandler.resume_many(tids, n))
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function gives the CPU directly to the READY thread tid.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid, int donate_quantum)
+{
+    if (_syncHandler.get_thread_by_id(tid) == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    _syncHandler.yield_to(tid, donate_quantum != 0);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function resumes the thread tid and gives it the CPU.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume_and_switch(int tid, int donate_quantum)
+{
+    if (_syncHandler.get_thread_by_id(tid) == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    _syncHandler.resume_and_switch(tid, donate_quantum != 0);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function tries to acquire a mutex.
+ * If the mutex is unlocked, it locks it and returns.
+ * If the mutex is already locked by different thread, the thread moves to BLOCK state.
+ * In the future when this thread will be back to RUNNING state,
+ * it will try again to acquire the mutex.
+ * If the mutex is already locked by this thread, it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_lock()
+{
+    if (_syncHandler.get_mutex_thread_id() == _syncHandler.get_running_thread_id())
+    {
+        return _syncHandler.return_and_print_error(MUTEX_ERR_MSG);
+    }
+    return _syncHandler.lock_mutex(__builtin_return_address(0));
+}
+
+
+/*
+ * Description: This function releases a mutex.
+ * If there are blocked threads waiting for this mutex,
+ * one of them (no matter which one) moves to READY state.
+ * If the mutex is already unlocked, it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_unlock()
+{
+    if (_syncHandler.get_mutex_thread_id() == UNLOCKED)
+    {
+        return _syncHandler.return_and_print_error(MUTEX_UNLOCK_ERR_MSG);
+
+    }
+    return _syncHandler.unlock_mutex();
+
+}
+
+/*
+ * Description: This function returns the thread ID of the calling thread.
+ * Return value: The ID of the calling thread.
+*/
+int uthread_get_tid()
+{
+    //todo : calling thread can be only the running one ?
+    return _syncHandler.get_running_thread_id();
+}
+
+/*
+ * Description: This function returns the total number of quantums since
+ * the library was initialized, including the current quantum.
+ * Right after the call to uthread_init, the value should be 1.
+ * Each time a new quantum starts, regardless of the reason, this number
+ * should be increased by 1.
+ * Return value: The total number of quantums.
+*/
+int uthread_get_total_quantums()
+{
+    return _syncHandler.get_total_quantums();
+}
+
+/*
+ * Description: This function returns the number of quantums the thread with
+ * ID tid was in RUNNING state. On the first time a thread runs, the function
+ * should return 1. Every additional quantum that the thread starts should
+ * increase this value by 1 (so if the thread with ID tid is in RUNNING state
+ * when this function is called, include also the current quantum). If no
+ * thread with ID tid exists it is considered an error.
+ * Return value: On success, return the number of quantums of the thread with ID tid.
+ * 			     On failure, return -1.
+*/
+int uthread_get_quantums(int tid)
+{
+    //if no thread with ID tid it's an error
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+
+    return _syncHandler.get_quantums_by_id(tid);
+}
+
+
+
+/*
+ * Description: This function switches the library to adaptive quantum sizing,
+ * keeping every chosen quantum within [min_usecs, max_usecs]. It is an error
+ * to pass a non-positive min_usecs or a max_usecs smaller than min_usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_adaptive_quantum(int min_usecs, int max_usecs)
+{
+    if (min_usecs <= NON_NEGATIVE_INT || max_usecs < min_usecs)
+    {
+        return _syncHandler.return_and_print_error(ADAPTIVE_QUANTUM_ERR_MSG);
+    }
+    _syncHandler.set_adaptive_quantum(min_usecs, max_usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the length of the quantum, in
+ * micro-seconds, that the thread with ID tid got the last time it was
+ * scheduled. If no thread with ID tid exists it is considered an error.
+ * Return value: On success, return the quantum length. On failure, return -1.
+*/
+int uthread_get_quantum_usecs(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+
+    return _syncHandler.get_quantum_usecs_by_id(tid);
+}
+
+/*
+ * Description: This function selects how the next READY thread is picked.
+ * It is an error to pass an unknown policy.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_sched_policy(int policy)
+{
+    if (policy != UTHREAD_SCHED_RR && policy != UTHREAD_SCHED_FAIR)
+    {
+        return _syncHandler.return_and_print_error(SCHED_POLICY_ERR_MSG);
+    }
+    _syncHandler.set_sched_policy(policy);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function sets the weight of the thread with ID tid under
+ * UTHREAD_SCHED_FAIR. If no thread with ID tid exists or weight is not
+ * positive it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_weight(int tid, int weight)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr || weight <= NON_NEGATIVE_INT)
+    {
+        return _syncHandler.return_and_print_error(WEIGHT_ERR_MSG);
+    }
+    _syncHandler.set_weight(tid, weight);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function limits the run time of the thread tid per period.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_cpu_quota(int tid, int quota_usecs, int period_usecs)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr || period_usecs < NON_NEGATIVE_INT ||
+        (period_usecs > NON_NEGATIVE_INT &&
+         (quota_usecs <= NON_NEGATIVE_INT || quota_usecs > period_usecs)))
+    {
+        return _syncHandler.return_and_print_error(QUOTA_ERR_MSG);
+    }
+    _syncHandler.set_cpu_quota(tid, quota_usecs, period_usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns how many times the thread tid was throttled.
+ * Return value: On success, the number of throttles. On failure, return -1.
+*/
+int uthread_get_throttle_count(int tid)
+{
+    if (_syncHandler.get_thread_by_id(tid) == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    return _syncHandler.get_throttle_count(tid);
+}
+
+/*
+ * Description: This function returns how long the thread tid was throttled.
+ * Return value: On success, the throttled time. On failure, return -1.
+*/
+long long uthread_get_throttled_usecs(int tid)
+{
+    if (_syncHandler.get_thread_by_id(tid) == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    return _syncHandler.get_throttled_usecs(tid);
+}
+
+/*
+ * Description: This function turns the run-next slot on or off.
+ * Return value: Always 0.
+*/
+int uthread_set_run_next(int enable)
+{
+    _syncHandler.set_run_next(enable != 0);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function sets the priority of the thread with ID tid.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int priority)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr || priority < NON_NEGATIVE_INT || priority >= UTHREAD_PRIORITY_LEVELS)
+    {
+        return _syncHandler.return_and_print_error(PRIORITY_ERR_MSG);
+    }
+    _syncHandler.set_priority(tid, priority);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns how many times the thread with ID tid
+ * inherited a waiter's priority.
+ * Return value: On success, return the count. On failure, return -1.
+*/
+int uthread_get_boost_count(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    return _syncHandler.get_boost_count(tid);
+}
+
+/*
+ * Description: This function returns how long the thread with ID tid ran
+ * at an inherited priority.
+ * Return value: On success, return the time. On failure, return -1.
+*/
+long long uthread_get_boosted_usecs(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    return _syncHandler.get_boosted_usecs(tid);
+}
+
+/*
+ * Description: This function puts the thread with ID tid in the deadline
+ * class with the given period and budget, or returns it to best-effort
+ * scheduling when both are 0.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_deadline(int tid, int period_usecs, int budget_usecs)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    bool leavesClass = (period_usecs == 0 && budget_usecs == 0);
+    if (currThread == nullptr ||
+        (!leavesClass && (budget_usecs <= NON_NEGATIVE_INT || budget_usecs > period_usecs)))
+    {
+        return _syncHandler.return_and_print_error(DEADLINE_ERR_MSG);
+    }
+    if (!_syncHandler.can_admit_deadline(tid, period_usecs, budget_usecs))
+    {
+        return _syncHandler.return_and_print_error(ADMISSION_ERR_MSG);
+    }
+    _syncHandler.set_deadline(tid, period_usecs, budget_usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function ends the current job of the calling deadline
+ * thread and waits for its next period.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_wait_next_period()
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(_syncHandler.get_running_thread_id());
+    if (!currThread->isDeadlineThread())
+    {
+        return _syncHandler.return_and_print_error(NOT_DEADLINE_ERR_MSG);
+    }
+    _syncHandler.wait_next_period();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the number of jobs of the thread with ID
+ * tid that did not finish by their deadline.
+ * Return value: On success, return the number of missed deadlines.
+ * On failure, return -1.
+*/
+int uthread_get_deadline_misses(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+
+    return _syncHandler.get_deadline_misses_by_id(tid);
+}
+
+/*
+ * Description: This function creates a uthread-local storage key with an
+ * optional destructor and stores it in *key.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_key_create(uthread_key_t* key, void (*destructor)(void*))
+{
+    int newKey = _syncHandler.create_key(destructor);
+    if (newKey == FAIL)
+    {
+        return _syncHandler.return_and_print_error(KEY_CREATE_ERR_MSG);
+    }
+    *key = newKey;
+    return SUCCESS;
+}
+
+/*
+ * Description: This function deletes a uthread-local storage key. It is an
+ * error to delete a key that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_key_delete(uthread_key_t key)
+{
+    if (!_syncHandler.is_valid_key(key))
+    {
+        return _syncHandler.return_and_print_error(INVALID_KEY_ERR_MSG);
+    }
+    _syncHandler.delete_key(key);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the calling thread's value for key.
+ * Return value: The value, or NULL if none was set or the key is invalid.
+*/
+void* uthread_getspecific(uthread_key_t key)
+{
+    if (!_syncHandler.is_valid_key(key))
+    {
+        return nullptr;
+    }
+    return _syncHandler.get_specific(key);
+}
+
+/*
+ * Description: This function sets the calling thread's value for key. It is
+ * an error to use a key that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_setspecific(uthread_key_t key, const void* value)
+{
+    if (!_syncHandler.is_valid_key(key))
+    {
+        return _syncHandler.return_and_print_error(INVALID_KEY_ERR_MSG);
+    }
+    _syncHandler.set_specific(key, const_cast<void*>(value));
+    return SUCCESS;
+}
+
+/*
+ * Description: This function allocates size bytes from the calling thread's
+ * own arena.
+ * Return value: On success, return the block. On failure, return NULL.
+*/
+void* uthread_alloc(size_t size)
+{
+    return _syncHandler.alloc(size);
+}
+
+/*
+ * Description: This function allocates size bytes that outlive the calling thread.
+ * Return value: On success, return the block. On failure, return NULL.
+*/
+void* uthread_alloc_shared(size_t size)
+{
+    return _syncHandler.alloc_shared(size);
+}
+
+/*
+ * Description: This function frees a block returned by uthread_alloc.
+ * Freeing NULL does nothing.
+*/
+void uthread_free(void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    _syncHandler.free_block(ptr);
+}
+
+/*
+ * Description: This function blocks the calling thread until another thread
+ * calls uthread_unpark on it, or consumes a pending permit.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_park()
+{
+    _syncHandler.park(0);
+    return SUCCESS;
+}
+
+/*
+ * Description: Same as uthread_park, but the thread also wakes up by itself
+ * once timeout_usecs micro-seconds have passed.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_park_timeout(int timeout_usecs)
+{
+    if (timeout_usecs <= NON_NEGATIVE_INT)
+    {
+        return _syncHandler.return_and_print_error(TIMEOUT_ERR_MSG);
+    }
+    _syncHandler.park(timeout_usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function blocks the calling thread for usecs
+ * micro-seconds of wall-clock time.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep(int usecs)
+{
+    if (usecs <= NON_NEGATIVE_INT)
+    {
+        return _syncHandler.return_and_print_error(TIMEOUT_ERR_MSG);
+    }
+    _syncHandler.sleep(usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function wakes the thread with ID tid if it is parked,
+ * and otherwise leaves it a permit. If no thread with ID tid exists it is
+ * considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_unpark(int tid)
+{
+    Thread* currThread = _syncHandler.get_thread_by_id(tid);
+    if (currThread == nullptr)
+    {
+        return _syncHandler.return_and_print_error(INVALID_TID_ERR_MSG);
+    }
+    _syncHandler.unpark(tid);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function queues a wakeup of the thread with ID tid. Safe
+ * to call from any kernel thread and from signal handlers, so the error is
+ * reported with write(2) rather than stdio.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume_remote(int tid)
+{
+    if (tid < 0 || tid >= MAX_THREAD_NUM)
+    {
+        ssize_t ignored = write(STDERR_FILENO, REMOTE_TID_ERR_MSG, sizeof(REMOTE_TID_ERR_MSG) - 1);
+        (void) ignored;
+        return FAIL;
+    }
+    _syncHandler.resume_remote(tid);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function turns stack profiling on or off for the
+ * threads spawned from now on.
+ * Return value: Always 0.
+*/
+int uthread_set_stack_profiling(int enable)
+{
+    _syncHandler.set_stack_profiling(enable != 0);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the peak stack usage of the thread
+ * with ID tid.
+ * Return value: On success, return the peak usage in bytes. On failure,
+ * return -1.
+*/
+int uthread_get_stack_peak(int tid)
+{
+    int peak = _syncHandler.get_stack_peak(tid);
+    if (peak == FAIL)
+    {
+        return _syncHandler.return_and_print_error(STACK_PEAK_ERR_MSG);
+    }
+    return peak;
+}
+
+/*
+ * Description: This function returns the peak stack usage over the profiled
+ * threads spawned with entry function f.
+ * Return value: On success, return the peak usage in bytes. On failure,
+ * return -1.
+*/
+int uthread_get_entry_stack_peak(void (*f)(void))
+{
+    int peak = _syncHandler.get_entry_stack_peak(f);
+    if (peak == FAIL)
+    {
+        return _syncHandler.return_and_print_error(ENTRY_STACK_PEAK_ERR_MSG);
+    }
+    return peak;
+}
+
+/*
+ * Description: This function writes a summary of the stack profile to fd.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_dump_stack_profile(int fd)
+{
+    if (_syncHandler.dump_stack_profile(fd) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(STACK_DUMP_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function seeds the slice jitter of a simulation.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_seed(unsigned int seed, int jitter_percent)
+{
+    if (!_syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(NOT_SIMULATED_ERR_MSG);
+    }
+    if (jitter_percent < NON_NEGATIVE_INT || jitter_percent >= 100)
+    {
+        return _syncHandler.return_and_print_error(SIM_SEED_ERR_MSG);
+    }
+    _syncHandler.sim_seed(seed, jitter_percent);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function moves the virtual clock of a simulation on,
+ * preempting the caller if its slice ends.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_tick(int usecs)
+{
+    if (!_syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(NOT_SIMULATED_ERR_MSG);
+    }
+    if (usecs <= NON_NEGATIVE_INT)
+    {
+        return _syncHandler.return_and_print_error(SIM_TICK_ERR_MSG);
+    }
+    _syncHandler.sim_tick(usecs);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function returns the virtual clock of a simulation.
+ * Return value: On success, return the virtual time. On failure, return -1.
+*/
+long long uthread_sim_now_usecs()
+{
+    if (!_syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(NOT_SIMULATED_ERR_MSG);
+    }
+    return _syncHandler.sim_now_usecs();
+}
+
+/*
+ * Description: This function records the schedule of a simulation to fd.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_record(int fd)
+{
+    if (!_syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(NOT_SIMULATED_ERR_MSG);
+    }
+    if (_syncHandler.sim_record(fd) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(SIM_RECORD_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function makes a simulation follow the schedule
+ * recorded in fd.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_replay(int fd)
+{
+    if (!_syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(NOT_SIMULATED_ERR_MSG);
+    }
+    if (_syncHandler.sim_replay(fd) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(SIM_REPLAY_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function reports how the replay of a schedule went.
+ * Return value: 1 while it is followed, 0 when done or none, -1 if left.
+*/
+int uthread_sim_replay_status()
+{
+    return _syncHandler.sim_replay_status();
+}
+
+/*
+ * Description: This function starts the sampling profiler.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_profiler_start(int sample_usecs)
+{
+    if (sample_usecs < NON_NEGATIVE_INT || _syncHandler.is_simulated())
+    {
+        return _syncHandler.return_and_print_error(PROFILER_START_ERR_MSG);
+    }
+    if (!_syncHandler.start_profiler(sample_usecs))
+    {
+        return _syncHandler.return_and_print_error(PROFILER_ALLOC_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function stops the sampling profiler.
+ * Return value: Always 0.
+*/
+int uthread_profiler_stop()
+{
+    _syncHandler.stop_profiler();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function writes the profile in folded-stack format.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_profiler_dump(int fd)
+{
+    if (_syncHandler.dump_profile(fd) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(PROFILER_DUMP_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function starts the mutex contention profiler.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_lock_profiler_start()
+{
+    if (!_syncHandler.start_lock_profiler())
+    {
+        return _syncHandler.return_and_print_error(LOCK_PROFILER_ALLOC_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function stops the mutex contention profiler.
+ * Return value: Always 0.
+*/
+int uthread_lock_profiler_stop()
+{
+    _syncHandler.stop_lock_profiler();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function writes the mutex contention profile as a report or JSON.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_lock_profiler_dump(int fd, int format)
+{
+    if ((format != UTHREAD_LOCK_PROFILE_TEXT && format != UTHREAD_LOCK_PROFILE_JSON) ||
+        _syncHandler.dump_lock_profile(fd, format == UTHREAD_LOCK_PROFILE_JSON) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(LOCK_PROFILER_DUMP_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function publishes the scheduler's counters to a
+ * shared-memory segment.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_metrics_publish(const char* name)
+{
+    if (_syncHandler.publish_metrics_to(name) == FAIL)
+    {
+        return _syncHandler.return_and_print_error(METRICS_PUBLISH_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function stops publishing and removes the segment.
+ * Return value: Always 0.
+*/
+int uthread_metrics_unpublish()
+{
+    _syncHandler.unpublish_metrics();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function enters an RCU read-side critical section.
+ * Return value: Always 0.
+*/
+int uthread_rcu_read_lock()
+{
+    _syncHandler.rcu_read_lock();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function leaves the innermost RCU read-side critical section.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_rcu_read_unlock()
+{
+    if (!_syncHandler.rcu_read_unlock())
+    {
+        return _syncHandler.return_and_print_error(RCU_UNLOCK_ERR_MSG);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Description: This function calls func(ptr) after a grace period.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_call_rcu(void (*func)(void*), void* ptr)
+{
+    if (func == nullptr)
+    {
+        return _syncHandler.return_and_print_error(RCU_CALLBACK_ERR_MSG);
+    }
+    _syncHandler.call_rcu(func, ptr);
+    return SUCCESS;
+}
+
+/*
+ * Description: This function blocks the calling thread until a grace period is over.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_synchronize_rcu()
+{
+    if (_syncHandler.in_rcu_read_section())
+    {
+        return _syncHandler.return_and_print_error(RCU_SYNCHRONIZE_ERR_MSG);
+    }
+    _syncHandler.synchronize_rcu();
+    return SUCCESS;
+}
+
+/*
+ * Description: This function blocks the calling thread until every callback retired before the
+ * call has run.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_rcu_barrier()
+{
+    if (_syncHandler.in_rcu_read_section())
+    {
+        return _syncHandler.return_and_print_error(RCU_BARRIER_ERR_MSG);
+    }
+    _syncHandler.rcu_barrier();
+    return SUCCESS;
+}
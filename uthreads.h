@@ -1,6 +1,8 @@
 #ifndef _UTHREADS_H
 #define _UTHREADS_H
 
+#include <stddef.h>
+
 /*
  * User-Level Threads Library (uthreads)
  * Author: OS, os@cs.huji.ac.il
@@ -8,6 +10,27 @@
 
 #define MAX_THREAD_NUM 100 /* maximal number of threads */
 #define STACK_SIZE 4096 /* stack size per thread (in bytes) */
+#define UTHREAD_KEYS_MAX 1024 /* maximal number of uthread-local storage keys */
+#define UTHREAD_KEYS_INLINE 16 /* keys below this are stored inside the thread record itself */
+#define UTHREAD_GROUPS_MAX MAX_THREAD_NUM /* maximal number of thread groups */
+#define UTHREAD_PRIORITY_LEVELS 8 /* thread priorities are 0 (the default, lowest) to 7 */
+
+typedef int uthread_key_t;
+typedef int uthread_group_t;
+
+/* Preemption clocks accepted by uthread_init_with_timer */
+#define UTHREAD_TIMER_VIRTUAL 0 /* setitimer(ITIMER_VIRTUAL): process CPU time */
+#define UTHREAD_TIMER_MONOTONIC 1 /* timer_create(CLOCK_MONOTONIC): wall-clock time */
+#define UTHREAD_TIMER_THREAD_CPU 2 /* timer_create(CLOCK_THREAD_CPUTIME_ID): scheduler thread CPU time */
+#define UTHREAD_TIMER_SIMULATED 3 /* no timer: a virtual clock advanced by uthread_sim_tick */
+
+/* Scheduling policies accepted by uthread_set_sched_policy */
+#define UTHREAD_SCHED_RR 0 /* round-robin over the READY threads (the default) */
+#define UTHREAD_SCHED_FAIR 1 /* weighted fair share: lowest virtual runtime runs first */
+
+/* Output formats of uthread_lock_profiler_dump */
+#define UTHREAD_LOCK_PROFILE_TEXT 0 /* an aligned report */
+#define UTHREAD_LOCK_PROFILE_JSON 1 /* a single JSON object */
 
 /* External interface */
 
@@ -22,6 +45,21 @@
 */
 int uthread_init(int quantum_usecs);
 
+/*
+ * Description: Same as uthread_init, but selects the clock that drives
+ * preemption. UTHREAD_TIMER_VIRTUAL is what uthread_init uses. The POSIX
+ * timer backends deliver the preemption signal only to the kernel thread that
+ * called this function, and UTHREAD_TIMER_MONOTONIC keeps counting while the
+ * process is blocked in a system call. UTHREAD_TIMER_SIMULATED replaces the
+ * real clock with a virtual one that only moves when a thread calls
+ * uthread_sim_tick (or when every thread waits, to the next wakeup), so that
+ * the same program is scheduled the same way on every run; see uthread_sim_*.
+ * It is an error to pass a non-positive quantum_usecs or an unknown
+ * timer_backend.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_init_with_timer(int quantum_usecs, int timer_backend);
+
 /*
  * Description: This function creates a new thread, whose entry point is the
  * function f with the signature void f(void). The thread is added to the end
@@ -71,12 +109,154 @@ int uthread_block(int tid);
 int uthread_resume(int tid);
 
 
+/*
+ * Description: This function creates an empty thread group and stores its ID
+ * in *group. Threads join a group when they are spawned into it and leave it
+ * when they terminate. The group counts the quantums and the CPU time of its
+ * members, including members that terminated since. It is an error to create
+ * more than UTHREAD_GROUPS_MAX groups at once.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_create(uthread_group_t* group);
+
+
+/*
+ * Description: This function deletes a thread group. It is an error to
+ * delete a group that does not exist or still has members.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_destroy(uthread_group_t group);
+
+
+/*
+ * Description: Same as uthread_spawn, but the new thread joins group. It is
+ * an error to pass a group that does not exist.
+ * Return value: On success, return the ID of the created thread.
+ * On failure, return -1.
+*/
+int uthread_spawn_in_group(void (*f)(void), uthread_group_t group);
+
+
+/*
+ * Description: This function blocks every member of group, as with
+ * uthread_block_many. If the calling thread is a member it blocks itself
+ * after all the others. It is an error to pass a group that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_block(uthread_group_t group);
+
+
+/*
+ * Description: This function resumes every member of group, as with
+ * uthread_resume_many. It is an error to pass a group that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_resume(uthread_group_t group);
+
+
+/*
+ * Description: This function terminates every member of group and releases
+ * their resources in one pass. The group itself stays, empty. If the calling
+ * thread is a member it terminates last and the function does not return.
+ * It is an error to pass a group that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_group_terminate(uthread_group_t group);
+
+
+/*
+ * Description: This function returns the number of quantums the members of
+ * group (current and terminated) were started. It is an error to pass a
+ * group that does not exist.
+ * Return value: On success, return the number of quantums.
+ * On failure, return -1.
+*/
+int uthread_group_get_quantums(uthread_group_t group);
+
+
+/*
+ * Description: This function returns the CPU time, in micro-seconds of
+ * CLOCK_MONOTONIC, that the members of group (current and terminated) ran.
+ * A running member's current quantum is added when it leaves the CPU. It is
+ * an error to pass a group that does not exist.
+ * Return value: On success, return the run time. On failure, return -1.
+*/
+long long uthread_group_get_cpu_usecs(uthread_group_t group);
+
+
+/*
+ * Description: This function creates n threads at once, the i-th with entry
+ * point fns[i], and stores their IDs in tids[0..n-1]. The threads are added
+ * to the end of the READY threads list in order. All of them are created in
+ * a single critical section, which makes a large fan-out much cheaper than
+ * n calls to uthread_spawn. It is an error to pass a non-positive n or a NULL
+ * array, or an n that would exceed MAX_THREAD_NUM concurrent threads; in
+ * that case no thread is created.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_spawn_many(void (*const fns[])(void), int n, int tids[]);
+
+
+/*
+ * Description: Same as calling uthread_block on tids[0..n-1], in a single
+ * critical section. If the calling thread is in tids it blocks itself after
+ * all the others. It is an error to pass a non-positive n, more than
+ * MAX_THREAD_NUM IDs, the main thread's ID or the ID of a thread that does
+ * not exist; in that case no thread is blocked.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_block_many(const int tids[], int n);
+
+
+/*
+ * Description: Same as calling uthread_resume on tids[0..n-1], in a single
+ * critical section. The resumed threads are added to the end of the READY
+ * threads list in order. It is an error to pass a non-positive n, more than
+ * MAX_THREAD_NUM IDs or the ID of a thread that does not exist; in that case
+ * no thread is resumed.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume_many(const int tids[], int n);
+
+
+/*
+ * Description: This function gives the CPU directly to the READY thread with
+ * ID tid, ahead of every other READY thread, e.g. to hand a request to the
+ * thread that serves it. The calling thread is moved to the end of the READY
+ * threads list. If donate_quantum is non-zero, tid runs for the rest of the
+ * caller's quantum instead of starting a new one (a deadline thread always
+ * runs under its own budget). Without it, two threads that keep handing the
+ * CPU to each other restart the quantum at every handoff and never let the
+ * other READY threads run. Yielding to a thread that is not READY, the
+ * caller included, has no effect and is not considered an error. If no
+ * thread with ID tid exists it is considered an error.
+ * Return value: On success, return 0 (once the caller runs again). On
+ * failure, return -1.
+*/
+int uthread_yield_to(int tid, int donate_quantum);
+
+
+/*
+ * Description: Same as uthread_resume(tid) followed by uthread_yield_to(tid,
+ * donate_quantum), in a single critical section, so a blocked, parked or
+ * sleeping thread is woken and runs at once: a ping-pong between two threads
+ * costs one context switch per direction. A thread that also waits for the
+ * mutex stays waiting for it and gets no CPU. If no thread with ID tid
+ * exists it is considered an error.
+ * Return value: On success, return 0 (once the caller runs again). On
+ * failure, return -1.
+*/
+int uthread_resume_and_switch(int tid, int donate_quantum);
+
+
 /*
  * Description: This function tries to acquire a mutex. 
  * If the mutex is unlocked, it locks it and returns. 
  * If the mutex is already locked by different thread, the thread moves to BLOCK state. 
  * In the future when this thread will be back to RUNNING state, 
  * it will try again to acquire the mutex. 
+ * While it waits, the thread holding the mutex inherits its priority if
+ * that is higher than the holder's own, until the holder unlocks.
  * If the mutex is already locked by this thread, it is considered an error. 
  * Return value: On success, return 0. On failure, return -1.
 */
@@ -86,7 +266,8 @@ int uthread_mutex_lock();
 /*
  * Description: This function releases a mutex. 
  * If there are blocked threads waiting for this mutex, 
- * one of them (no matter which one) moves to READY state.
+ * the one with the highest priority (the longest waiting among equals)
+ * moves to READY state, and takes the CPU at once if it outranks the caller.
  * If the mutex is already unlocked, it is considered an error. 
  * Return value: On success, return 0. On failure, return -1.
 */
@@ -123,5 +304,583 @@ int uthread_get_total_quantums();
 */
 int uthread_get_quantums(int tid);
 
-#endif
 
+/*
+ * Description: This function switches the library to adaptive quantum sizing.
+ * Every thread gets its own quantum, chosen each time it starts running from
+ * its recent run lengths and how often it blocks: threads that keep using up
+ * their whole quantum get longer ones while no latency-sensitive thread is
+ * READY, and shorter ones when such threads are waiting. Latency-sensitive
+ * threads get about twice their usual run length. The chosen quantum always
+ * stays within [min_usecs, max_usecs]. It is an error to pass a non-positive
+ * min_usecs or a max_usecs smaller than min_usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_adaptive_quantum(int min_usecs, int max_usecs);
+
+
+/*
+ * Description: This function returns the length of the quantum, in
+ * micro-seconds, that the thread with ID tid got the last time it was
+ * scheduled (the current one if it is RUNNING). If no thread with ID tid
+ * exists it is considered an error.
+ * Return value: On success, return the quantum length. On failure, return -1.
+*/
+int uthread_get_quantum_usecs(int tid);
+
+
+/*
+ * Description: This function selects how the next READY thread is picked.
+ * Under UTHREAD_SCHED_FAIR every thread accumulates virtual runtime (its
+ * run time divided by its weight) and the READY thread with the least
+ * virtual runtime runs next, so over time each thread gets CPU in proportion
+ * to its weight. A thread that becomes READY after a long wait is given at
+ * most one quantum of credit over the others. It is an error to pass an
+ * unknown policy.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_sched_policy(int policy);
+
+
+/*
+ * Description: This function sets the weight of the thread with ID tid under
+ * UTHREAD_SCHED_FAIR. Threads start with weight 1; a thread of weight 3 gets
+ * three times the CPU of a thread of weight 1. If no thread with ID tid
+ * exists or weight is not positive it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_weight(int tid, int weight);
+
+
+/*
+ * Description: This function limits the thread with ID tid to quota_usecs
+ * micro-seconds of run time in every period_usecs, like a cgroup CPU
+ * bandwidth limit, so a runaway thread has a bounded impact on the others.
+ * Once the thread has used up its quota it is THROTTLED: it does not run,
+ * and is not BLOCKED either, until its next period starts, when it becomes
+ * READY again with a full quota. Periods start when the quota is set. Run
+ * time over the quota is forgiven at the next period. Setting a new quota
+ * ends a throttle at once; period_usecs == 0 lifts the limit. Blocking a
+ * THROTTLED thread ends its throttle, and it may be throttled again when it
+ * is resumed. Threads in the deadline class are held to their budget
+ * instead. If no thread with ID tid exists, period_usecs is negative, or
+ * quota_usecs is not within (0, period_usecs] (when period_usecs is
+ * positive) it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_cpu_quota(int tid, int quota_usecs, int period_usecs);
+
+
+/*
+ * Description: This function returns how many times the thread with ID tid
+ * was throttled for using up its CPU quota. If no thread with ID tid exists
+ * it is considered an error.
+ * Return value: On success, return the number of throttles. On failure,
+ * return -1.
+*/
+int uthread_get_throttle_count(int tid);
+
+
+/*
+ * Description: This function returns how long, in micro-seconds, the thread
+ * with ID tid has spent THROTTLED, the current throttle included. If no
+ * thread with ID tid exists it is considered an error.
+ * Return value: On success, return the throttled time. On failure, return -1.
+*/
+long long uthread_get_throttled_usecs(int tid);
+
+
+/*
+ * Description: This function turns the run-next slot on (enable != 0) or off.
+ * While it is on, a thread made READY by the running thread (through
+ * uthread_resume, uthread_unpark or uthread_mutex_unlock) runs as soon as the
+ * running thread gives up the CPU, ahead of the other READY threads, while
+ * the data it shares with its waker is still in the cache. A later wakeup
+ * takes the slot over and sends the earlier thread to the end of the READY
+ * threads list. Threads that keep waking each other run from the slot for at
+ * most one quantum in a row, then the other READY threads get their turn.
+ * Deadline threads and threads woken by a timeout or by
+ * uthread_resume_remote are queued as usual. Under the priority policy the
+ * slot never runs before a higher-priority READY thread. It is off by
+ * default.
+ * Return value: Always 0.
+*/
+int uthread_set_run_next(int enable);
+
+
+/*
+ * Description: This function sets the priority of the thread with ID tid,
+ * from 0 (the default) to UTHREAD_PRIORITY_LEVELS - 1. Priorities only take
+ * effect when the library is built with the priority ready queue
+ * (UTHREADS_SCHED_POLICY=PRIORITY): there the READY thread with the highest
+ * priority runs next, round-robin among equals. Other builds record the
+ * value and ignore it. If no thread with ID tid exists or priority is out
+ * of range it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int priority);
+
+
+/*
+ * Description: This function returns how many times the thread with ID tid
+ * inherited a higher priority while holding the mutex, from a thread that
+ * waited for it. If no thread with ID tid exists it is considered an error.
+ * Return value: On success, return the count. On failure, return -1.
+*/
+int uthread_get_boost_count(int tid);
+
+
+/*
+ * Description: This function returns how long, in micro-seconds of
+ * CLOCK_MONOTONIC, the thread with ID tid has held the mutex at a priority
+ * inherited from a waiter, the current boost included. If no thread with ID
+ * tid exists it is considered an error.
+ * Return value: On success, return the time. On failure, return -1.
+*/
+long long uthread_get_boosted_usecs(int tid);
+
+
+/*
+ * Description: This function puts the thread with ID tid in the deadline
+ * (earliest-deadline-first) class: every period_usecs micro-seconds a new job
+ * of the thread is released, and that job should finish within the period
+ * using at most budget_usecs of CPU. READY deadline threads always run before
+ * the other threads, earliest deadline first, and a deadline thread that
+ * becomes READY preempts a running best-effort thread. A job that uses up its
+ * budget keeps running as a best-effort thread until its next period. The
+ * first job is released immediately. Passing period_usecs == 0 and
+ * budget_usecs == 0 returns the thread to best-effort scheduling.
+ * It is an error if no thread with ID tid exists, if budget_usecs is not
+ * within (0, period_usecs], or if admitting the thread would make the deadline
+ * class reserve more than 90% of the CPU.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_deadline(int tid, int period_usecs, int budget_usecs);
+
+
+/*
+ * Description: This function ends the current job of the calling deadline
+ * thread. The thread waits until its next period starts; if the job already
+ * missed its deadline it is counted as a miss and the thread continues with
+ * its next job right away. It is an error to call this function from a thread
+ * that is not in the deadline class.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_wait_next_period();
+
+
+/*
+ * Description: This function returns the number of jobs of the thread with ID
+ * tid that did not finish by their deadline. If no thread with ID tid exists
+ * it is considered an error.
+ * Return value: On success, return the number of missed deadlines.
+ * On failure, return -1.
+*/
+int uthread_get_deadline_misses(int tid);
+
+
+/*
+ * Description: This function creates a uthread-local storage key and stores it
+ * in *key. Every thread sees its own value for the key, initially NULL. When a
+ * thread is terminated, destructor (if not NULL) is called with the thread's
+ * value for the key, if that value is not NULL. It is an error to create more
+ * than UTHREAD_KEYS_MAX keys at once.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_key_create(uthread_key_t* key, void (*destructor)(void*));
+
+
+/*
+ * Description: This function deletes a key created by uthread_key_create. The
+ * values the threads hold for it are dropped without calling the destructor.
+ * It is an error to delete a key that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_key_delete(uthread_key_t key);
+
+
+/*
+ * Description: This function returns the calling thread's value for key.
+ * Keys below UTHREAD_KEYS_INLINE cost a single indexed load.
+ * Return value: The value, or NULL if none was set or the key is invalid.
+*/
+void* uthread_getspecific(uthread_key_t key);
+
+
+/*
+ * Description: This function sets the calling thread's value for key. It is
+ * an error to use a key that does not exist.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_setspecific(uthread_key_t key, const void* value);
+
+
+/*
+ * Description: This function allocates size bytes from the calling thread's
+ * own arena. The block is aligned to 16 bytes. Allocating needs no lock and no
+ * signal masking, so it is safe under preemption, unlike malloc. All the
+ * blocks of a thread are released at once when the thread is terminated, so
+ * they must not be used by other threads after that. This function must not
+ * be called from a signal handler.
+ * Return value: On success, return the block. On failure, return NULL.
+*/
+void* uthread_alloc(size_t size);
+
+
+/*
+ * Description: This function frees a block returned by uthread_alloc or
+ * uthread_alloc_shared. Any thread may free it; a block freed by a thread
+ * other than its allocator is handed back to the arena it came from. Freeing
+ * NULL does nothing.
+*/
+void uthread_free(void* ptr);
+
+
+/*
+ * Description: Same as uthread_alloc, but the block comes from an arena that
+ * belongs to no thread, so it stays valid after the allocating thread is
+ * terminated, until uthread_free or the end of the process. Allocating blocks
+ * the signals for a moment, which makes it slower than uthread_alloc. Blocks
+ * are freed with uthread_free, by any thread.
+ * Return value: On success, return the block. On failure, return NULL.
+*/
+void* uthread_alloc_shared(size_t size);
+
+
+/*
+ * Description: This function blocks the calling thread until another thread
+ * calls uthread_unpark on it. If uthread_unpark was called since the last
+ * park, the function consumes that permit and returns immediately, so a
+ * wakeup that arrives before the thread parks is never lost. Unlike
+ * uthread_block, the main thread may park.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_park();
+
+
+/*
+ * Description: Same as uthread_park, but the thread also wakes up by itself
+ * once timeout_usecs micro-seconds have passed. It is an error to pass a
+ * non-positive timeout_usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_park_timeout(int timeout_usecs);
+
+
+/*
+ * Description: This function blocks the calling thread for usecs
+ * micro-seconds of wall-clock time, during which other threads run (or the
+ * process idles). A uthread_resume on the sleeping thread ends the sleep
+ * early. Unlike uthread_block, the main thread may sleep. It is an error to
+ * pass a non-positive usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep(int usecs);
+
+
+/*
+ * Description: This function wakes the thread with ID tid if it is parked,
+ * and otherwise makes its next uthread_park return immediately. If no thread
+ * with ID tid exists it is considered an error.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_unpark(int tid);
+
+
+/*
+ * Description: This function wakes the thread with ID tid from outside the
+ * library's control: it may be called from any kernel thread of the process
+ * and from signal handlers, where the other functions of this library must
+ * not be used. The wakeup is queued without locks and takes effect at the
+ * next scheduling point, or at once if the scheduler is idle: a blocked or
+ * parked thread becomes READY, any other thread gets a park permit as with
+ * uthread_unpark. A wakeup for a thread that terminates before it is handled
+ * is dropped. It is an error to pass a tid out of the range of thread IDs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_resume_remote(int tid);
+
+
+/*
+ * Description: This function turns stack profiling on (enable != 0) or off
+ * for the threads spawned from now on. The stack of a profiled thread is
+ * filled with a known pattern when it is spawned, which makes spawning
+ * slower, so that the deepest point the thread has reached can be found
+ * later. The main thread runs on the process stack and is never profiled.
+ * Return value: Always 0.
+*/
+int uthread_set_stack_profiling(int enable);
+
+
+/*
+ * Description: This function returns the most bytes of its stack the thread
+ * with ID tid has used so far, including the signal frames of preemptions.
+ * The stack holds STACK_SIZE bytes plus room for one signal frame. It is an
+ * error if no thread with ID tid exists or its stack is not profiled.
+ * Return value: On success, return the peak usage in bytes. On failure,
+ * return -1.
+*/
+int uthread_get_stack_peak(int tid);
+
+
+/*
+ * Description: This function returns the most stack, in bytes, used by any
+ * profiled thread spawned with entry function f, both the live ones and the
+ * ones that terminated. It is an error if no profiled thread was spawned
+ * with f.
+ * Return value: On success, return the peak usage in bytes. On failure,
+ * return -1.
+*/
+int uthread_get_entry_stack_peak(void (*f)(void));
+
+
+/*
+ * Description: This function writes a summary of the stack profile to the
+ * file descriptor fd: the peak usage of every live profiled thread, then per
+ * entry function the number of profiled threads spawned with it and their
+ * peak usage. Entry functions are listed by address. It is an error if
+ * writing to fd fails.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_dump_stack_profile(int fd);
+
+
+/*
+ * Description: This function seeds the simulation started with
+ * UTHREAD_TIMER_SIMULATED. From now on every slice ends up to
+ * jitter_percent percent of its length earlier or later than the quantum,
+ * drawn from a generator started from seed, so different seeds explore
+ * different interleavings and the same seed repeats one. Jitter 0 (the
+ * default) keeps the slices exact. It is an error to call this function
+ * outside a simulation or to pass jitter_percent outside [0, 100).
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_seed(unsigned int seed, int jitter_percent);
+
+
+/*
+ * Description: This function moves the virtual clock of a simulation usecs
+ * micro-seconds on, standing for the work the calling thread did since its
+ * last tick. This is the only place a simulated thread is preempted: when
+ * its slice ends here the next thread runs, and the call returns when the
+ * caller is scheduled again. Sleeps, timeouts and deadlines all run on the
+ * virtual clock. It is an error to call this function outside a simulation
+ * or to pass a non-positive usecs.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_tick(int usecs);
+
+
+/*
+ * Description: This function returns the virtual clock of a simulation in
+ * micro-seconds. It is an error to call this function outside a simulation.
+ * Return value: On success, return the virtual time. On failure, return -1.
+*/
+long long uthread_sim_now_usecs();
+
+
+/*
+ * Description: This function starts recording the schedule of a simulation
+ * to the file descriptor fd: the seed, then one line per scheduling decision
+ * with its virtual time, the thread that got the CPU and whether a slice end
+ * or the previous thread giving up the CPU led to it. It is an error to call
+ * this function outside a simulation or if writing to fd fails.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_record(int fd);
+
+
+/*
+ * Description: This function loads a schedule written by uthread_sim_record
+ * from the file descriptor fd and makes the simulation follow it from the
+ * next scheduling decision on: slices end exactly at the recorded times and
+ * the recorded threads run, whatever the scheduler would have chosen. This
+ * pins a run to a recorded timeline, e.g. to compare two versions of the
+ * scheduler. The recorded seed replaces the current one. As soon as the run
+ * cannot follow the schedule (the recorded thread is not READY at the
+ * recorded time) the replay stops, an error is printed and the scheduler
+ * decides again. It is an error to call this function outside a simulation
+ * or if fd does not hold a schedule.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sim_replay(int fd);
+
+
+/*
+ * Description: This function reports how the replay of a schedule loaded by
+ * uthread_sim_replay went so far.
+ * Return value: 1 while the replay is being followed, 0 once it was followed
+ * to its end or if none was loaded, -1 if the run left it.
+*/
+int uthread_sim_replay_status();
+
+
+/*
+ * Description: This function starts the sampling profiler, discarding the
+ * samples of an earlier run. Each sample records the running thread's ID,
+ * its entry function, the code address it was interrupted at and the calls
+ * leading there, found by following frame pointers (build with
+ * -fno-omit-frame-pointer for full stacks). With sample_usecs == 0 a sample
+ * is taken at every preemption tick. Otherwise one is taken every
+ * sample_usecs micro-seconds of CPU time of the kernel thread that runs the
+ * uthreads, using SIGPROF. Up to 32768 samples are kept; later
+ * ones are dropped. It is an error to pass a negative sample_usecs or to call
+ * this function in a simulation, where there are no signals to sample from.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_profiler_start(int sample_usecs);
+
+
+/*
+ * Description: This function stops the sampling profiler. The samples are
+ * kept for uthread_profiler_dump.
+ * Return value: Always 0.
+*/
+int uthread_profiler_stop();
+
+
+/*
+ * Description: This function writes the samples of the sampling profiler to
+ * the file descriptor fd in folded-stack format, one line per distinct stack
+ * with its sample count, e.g.
+ *     uthread-3;worker;worker;compute 42
+ * The root is the thread ID and its entry function ("main" for the main
+ * thread), then the frames from the outermost to the interrupted one.
+ * Functions not in the dynamic symbol table (link with -rdynamic to add them)
+ * appear as module+offset. The output feeds flamegraph.pl and similar tools.
+ * It is an error if writing to fd fails.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_profiler_dump(int fd);
+
+
+/*
+ * Description: This function starts the mutex contention profiler,
+ * discarding the counters of an earlier run. From now on every
+ * uthread_mutex_lock is charged to its call site (the return address into the
+ * caller), with the number of acquires, how many had to wait, and the wait
+ * and hold times, as totals, maxima and histograms with power-of-2 buckets in
+ * nano-seconds. The 16 longest single holds are kept with the holding
+ * thread. Recording costs one clock read per acquire, one more when the
+ * acquire has to wait, and one per release, so the profiler can stay on in
+ * production. Up to 256 call sites are tracked; acquires at further sites
+ * are only counted. It is an error if the counters cannot be allocated.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_lock_profiler_start();
+
+
+/*
+ * Description: This function stops the mutex contention profiler. The
+ * counters are kept for uthread_lock_profiler_dump.
+ * Return value: Always 0.
+*/
+int uthread_lock_profiler_stop();
+
+
+/*
+ * Description: This function writes the counters of the mutex contention
+ * profiler to the file descriptor fd, the call sites callers waited at the
+ * longest first, followed by the longest holds. With
+ * UTHREAD_LOCK_PROFILE_TEXT the output is an aligned report naming each site
+ * after its function (link with -rdynamic to name functions of the
+ * executable) and address; with UTHREAD_LOCK_PROFILE_JSON it is one JSON
+ * object with the same content, whose histograms are arrays where entry i
+ * counts the times in [2^i, 2^(i+1)) nano-seconds. It is an error to pass
+ * another format or if writing to fd fails.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_lock_profiler_dump(int fd, int format);
+
+
+/*
+ * Description: This function makes the scheduler publish its counters to the
+ * POSIX shared-memory segment name (see shm_open; "/uthreads.<pid>" when name
+ * is NULL), so a monitoring process can read them without calling into this
+ * one. The layout is struct uthread_metrics in uthread_metrics.h: the total
+ * number of quantums, the running thread, the number of READY threads, the
+ * mutex owner and its number of waiters, and the state and quantum count of
+ * every thread. It is rewritten in place at every switch and when the
+ * scheduler goes idle, so it reflects the scheduler as of the last switch;
+ * readers take consistent copies with uthread_metrics_snapshot. A segment
+ * published before is removed. The segment is removed when the process
+ * terminates through uthread_terminate(0). It is an error if the segment
+ * cannot be created.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_metrics_publish(const char* name);
+
+
+/*
+ * Description: This function stops publishing the scheduler's counters and
+ * removes the segment. Readers that mapped it keep their (now frozen) copy.
+ * Return value: Always 0.
+*/
+int uthread_metrics_unpublish();
+
+
+/*
+ * Description: This function enters an RCU read-side critical section of the
+ * calling thread. Until the matching uthread_rcu_read_unlock, the data the
+ * thread reads from RCU-protected structures stays valid: a writer that
+ * unlinked it reclaims it only after the thread leaves the section (see
+ * uthread_call_rcu and uthread_synchronize_rcu). Sections nest. Entering and
+ * leaving one only updates a counter of the calling thread, no lock is taken
+ * and the thread may be preempted inside; it must not block inside, or every
+ * reclamation waits for it.
+ * Return value: Always 0.
+*/
+int uthread_rcu_read_lock();
+
+
+/*
+ * Description: This function leaves the innermost RCU read-side critical
+ * section of the calling thread. It is an error if the thread is in none.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_rcu_read_unlock();
+
+
+/*
+ * Description: This function defers the reclamation of data a writer
+ * unlinked from an RCU-protected structure: func(ptr) is called once every
+ * thread that was in a read-side critical section at the time of the call
+ * has left it (a grace period). A grace period is over once each of those
+ * threads is switched out with no section open, or terminates; without such
+ * threads it is over at once. Callbacks retired while a grace period is under
+ * way share the next one. The callbacks whose grace period is over run in the
+ * next thread that leaves its outermost read-side critical section or calls
+ * uthread_call_rcu, uthread_synchronize_rcu or uthread_rcu_barrier, never in
+ * the scheduler, so they may free memory or call this library. It is an error
+ * if func is NULL.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_call_rcu(void (*func)(void*), void* ptr);
+
+
+/*
+ * Description: This function blocks the calling thread until every thread
+ * that was in a read-side critical section at the time of the call has left
+ * it, then runs the RCU callbacks whose grace period is over, including those
+ * retired with uthread_call_rcu before the call. A uthread_resume of the
+ * calling thread does not end the wait. It is an error to call this function
+ * inside a read-side critical section, where it would wait for itself.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_synchronize_rcu();
+
+
+/*
+ * Description: This function blocks the calling thread until every callback
+ * retired with uthread_call_rcu before the call has run, running the ones
+ * whose grace period is over itself. It waits only if some of those callbacks
+ * are still waiting for their grace period, so a program that stopped
+ * retiring can call it to flush the callbacks no later reader or writer would
+ * run. A uthread_resume of the calling thread does not end the wait. It is an
+ * error to call this function inside a read-side critical section, where it
+ * would wait for itself.
+ * Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_rcu_barrier();
+
+#endif